@@ -64,19 +64,8 @@ filter "platforms:x32"
 filter "platforms:x64"
 	architecture "x64"
 
-workspace "etherdream-glsl"
-	language "C++"
-	location "build"
-	startproject "etherdream-glsl"
-
-project "etherdream-glsl"
-	debugargs {
-		"-s",
-		"../../../example.frag",
-	}
-	files {
-		"src/common/**",
-	}
+-- Settings shared by the application and the benchmark.
+function commonProject()
 	includedirs {
 		"src",
 		"deps/include",
@@ -111,7 +100,9 @@ project "etherdream-glsl"
 			"src/linux/**",
 		}
 		links {
-			"etherdream"
+			"etherdream",
+			"pthread",
+			"rt",
 		}
 
 	filter { "system:linux", "platforms:x32" }
@@ -152,6 +143,7 @@ project "etherdream-glsl"
 		}
 		links {
 			"EtherDream",
+			"winmm",
 		}
 
 	filter { "system:windows", "platforms:x32" }
@@ -165,3 +157,45 @@ project "etherdream-glsl"
 		libdirs {
 			"deps/windows/lib64",
 		}
+
+	filter {}
+end
+
+workspace "etherdream-glsl"
+	language "C++"
+	location "build"
+	startproject "etherdream-glsl"
+
+project "etherdream-glsl"
+	debugargs {
+		"-s",
+		"../../../example.frag",
+	}
+	files {
+		"src/common/**",
+	}
+	commonProject()
+
+project "benchmark"
+	debugargs {
+		"-s",
+		"../../../example.frag",
+	}
+	files {
+		"src/benchmark/**",
+		"src/common/**",
+	}
+	removefiles {
+		"src/common/main.cpp",
+	}
+	commonProject()
+
+project "tests"
+	files {
+		"src/common/**",
+		"src/tests/**",
+	}
+	removefiles {
+		"src/common/main.cpp",
+	}
+	commonProject()
@@ -0,0 +1,361 @@
+#include <algorithm>
+#include <cli.hpp>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <streambuf>
+#include <vector>
+
+#include "../common/BatchArena.hpp"
+#include "../common/ConsoleOutput.hpp"
+#include "../common/context.hpp"
+#include "../common/NullOutput.hpp"
+#include "../common/opengl.hpp"
+#include "../common/PointBuffer.hpp"
+#include "../common/PointPipeline.hpp"
+#include "../common/RenderProfiler.hpp"
+#include "../common/ShaderPreprocessor.hpp"
+
+#if defined(SYSTEM_WINDOWS)
+#include "../windows/EtherDreamOutput.hpp"
+#endif
+
+// Measures each stage of the streaming loop in isolation, and the whole loop, at several batch sizes. Results are
+// printed as one JSON object per line, so that runs can be collected and compared between versions.
+
+enum ExitCode
+{
+	Success,
+	ParameterError,
+	ContextCreationFailed,
+	ExtensionsInitializationFailed,
+	InvalidShaderCode,
+};
+
+static CommonParameters commonParameters;
+static float measureDuration; // Per stage and batch size, in seconds.
+
+// Discards what is written, so that formatting is measured without the terminal.
+class NullStreamBuffer : public std::streambuf
+{
+protected:
+	int overflow(int c) override
+	{
+		return c;
+	}
+};
+
+RenderProfiler::Timing measure(const std::function<void()> &step)
+{
+	return RenderProfiler::measureSteps({ step }, measureDuration).front();
+}
+
+void printResult(const char *name, int pointCount, const RenderProfiler::Timing &timing)
+{
+	auto pointsPerSecond = (int64_t)(pointCount * commonParameters.dacCount * 1e9 / std::max(timing.medianDuration, (int64_t)1));
+
+	std::cout << "{\"benchmark\":\"" << name << "\""
+		<< ",\"points\":" << pointCount
+		<< ",\"dacs\":" << commonParameters.dacCount
+		<< ",\"batches\":" << timing.batchCount
+		<< ",\"median_ns\":" << timing.medianDuration
+		<< ",\"p95_ns\":" << timing.percentileDuration
+		<< ",\"points_per_second\":" << pointsPerSecond
+		<< "}" << std::endl;
+}
+
+bool parsePointCounts(const std::string &description, std::vector<int> &pointCounts)
+{
+	std::istringstream stream{ description };
+	std::string item;
+	while (std::getline(stream, item, ','))
+	{
+		auto pointCount = std::atoi(item.c_str());
+		if (pointCount <= 0)
+		{
+			return false;
+		}
+		pointCounts.push_back(pointCount);
+	}
+	return !pointCounts.empty();
+}
+
+int benchmark(int pointCount, const Shader &fragmentShader, std::vector<PointPipeline> &pipelines, Output &consoleOutput, Output &nullOutput)
+{
+	auto totalPointCount = pointCount * commonParameters.dacCount;
+
+	// The vertex shader depends on the batch size.
+	Shader vertexShader{ GL_VERTEX_SHADER };
+	vertexShader.compile(Quad::getVertexSource(pointCount));
+
+	Program program{ vertexShader, fragmentShader };
+	if (!program.link())
+	{
+		std::cerr << "Failed to link program." << std::endl;
+		return ExitCode::InvalidShaderCode;
+	}
+
+	BatchArena arena{ false };
+	auto bufferCapacity = PointPipeline::getMaxCapacity(pipelines, pointCount);
+
+	std::vector<PointBuffer> buffers;
+	buffers.reserve(commonParameters.dacCount);
+	for (int dacIndex = 0; dacIndex < commonParameters.dacCount; ++dacIndex)
+	{
+		buffers.emplace_back(bufferCapacity, arena);
+	}
+
+	// A readback kept for the stages after it.
+	std::vector<float> pointsXY(totalPointCount * 2);
+	std::vector<float> pointsRGB(totalPointCount * 3);
+
+	RenderProfiler profiler{ program, commonParameters.dacCount };
+	auto renderMeasurement = profiler.measure(pointCount, measureDuration, [&](const float *readXY, const float *readRGB)
+	{
+		std::copy(readXY, readXY + pointsXY.size(), pointsXY.begin());
+		std::copy(readRGB, readRGB + pointsRGB.size(), pointsRGB.begin());
+	});
+
+	auto unpackPoints = [&](const float *dacPointsXY, const float *dacPointsRGB)
+	{
+		for (int dacIndex = 0; dacIndex < commonParameters.dacCount; ++dacIndex)
+		{
+			buffers[dacIndex].unpack(dacPointsXY + dacIndex * pointCount * 2, dacPointsRGB + dacIndex * pointCount * 3, pointCount);
+		}
+	};
+
+	auto unpack = [&]()
+	{
+		unpackPoints(pointsXY.data(), pointsRGB.data());
+	};
+
+	auto process = [&]()
+	{
+		for (int dacIndex = 0; dacIndex < commonParameters.dacCount; ++dacIndex)
+		{
+			pipelines[dacIndex].process(buffers[dacIndex]);
+		}
+		PointPipeline::equalizeCounts(buffers);
+	};
+
+	auto stream = [&]()
+	{
+		nullOutput.streamPoints(buffers.data());
+	};
+
+	printResult("render", pointCount, renderMeasurement.render);
+
+	printResult("readback", pointCount, renderMeasurement.readback);
+
+	printResult("unpack", pointCount, measure(unpack));
+
+	// Stages may change the point count, so points are unpacked again before each run.
+	auto pipelinesEmpty = std::all_of(pipelines.begin(), pipelines.end(), [](const PointPipeline &pipeline)
+	{
+		return pipeline.isEmpty();
+	});
+	if (!pipelinesEmpty)
+	{
+		printResult("unpack-pipeline", pointCount, measure([&]()
+		{
+			unpack();
+			process();
+		}));
+	}
+
+#if defined(SYSTEM_WINDOWS)
+	auto etherDreamPoints = arena.allocate<EAD_Pnt_s>(buffers.front().getCapacity());
+	printResult("etherdream-convert", pointCount, measure([&]()
+	{
+		for (auto &buffer : buffers)
+		{
+			EtherDreamOutput::convertPoints(buffer, etherDreamPoints);
+		}
+	}));
+#endif
+
+	NullStreamBuffer nullStreamBuffer;
+	auto coutBuffer = std::cout.rdbuf(&nullStreamBuffer);
+	auto consoleResult = measure([&]()
+	{
+		consoleOutput.streamPoints(buffers.data());
+	});
+	std::cout.rdbuf(coutBuffer);
+	printResult("console-format", pointCount, consoleResult);
+
+	printResult("null-stream", pointCount, measure(stream));
+
+	auto endToEndMeasurement = profiler.measure(pointCount, measureDuration, [&](const float *readXY, const float *readRGB)
+	{
+		unpackPoints(readXY, readRGB);
+		process();
+		stream();
+	});
+	printResult("end-to-end", pointCount, endToEndMeasurement.total);
+
+	return ExitCode::Success;
+}
+
+// GL objects are released before the context.
+int run(const std::vector<int> &pointCounts, std::vector<PointPipeline> &pipelines, Output &consoleOutput, Output &nullOutput)
+{
+	// Uniform declarations of the main program are not inserted, shaders relying on them do not compile.
+	ShaderPreprocessor shaderPreprocessor{ nullptr, []()
+	{
+	} };
+
+	std::string shaderSource;
+	if (!shaderPreprocessor.preprocess(commonParameters.shaderPath, shaderSource))
+	{
+		return ExitCode::InvalidShaderCode;
+	}
+
+	Shader fragmentShader{ GL_FRAGMENT_SHADER };
+	fragmentShader.compile(shaderSource, [&](const std::string &log)
+	{
+		return shaderPreprocessor.translateLog(log);
+	});
+
+	for (auto pointCount : pointCounts)
+	{
+		auto exitCode = benchmark(pointCount, fragmentShader, pipelines, consoleOutput, nullOutput);
+		if (exitCode != ExitCode::Success)
+		{
+			return exitCode;
+		}
+	}
+
+	return ExitCode::Success;
+}
+
+int main(int argc, char **argv)
+{
+	cli::Parser parser{ argc, argv };
+
+	commonParameters.dacCount = parser.option("dac-count")
+		.alias("dc")
+		.description("Number of DACs rendered per batch.")
+		.defaultValue("1")
+		.getValueAs<int>();
+
+	commonParameters.pointsPerSecond = parser.option("points-per-second")
+		.alias("pps")
+		.description("Laser rate, for stages which depend on it.")
+		.defaultValue("30000")
+		.getValueAs<uint16_t>();
+
+	commonParameters.shaderPath = parser.option("shader")
+		.alias("s")
+		.description("Shader file path.")
+		.getValueAs<std::string>();
+
+	commonParameters.verbose = parser.flag("verbose")
+		.alias("v")
+		.description("Enables verbose output.")
+		.getValue();
+
+	auto pointCountsDescription = parser.option("point-counts")
+		.alias("pc")
+		.description("Batch sizes per DAC, separated by commas.")
+		.defaultValue("256,1024,4096,16384")
+		.getValue();
+
+	measureDuration = parser.option("duration")
+		.alias("du")
+		.description("Minimum duration of each measurement, in seconds.")
+		.defaultValue(".5")
+		.getValueAs<float>();
+
+	auto pipelineDescription = parser.option("pipeline")
+		.alias("pi")
+		.description("Point processing stages, e.g. \"rotate 90; gain 1 .8 .8\".")
+		.getValue();
+
+	ConsoleOutput consoleOutput{ commonParameters, parser };
+	NullOutput nullOutput{ commonParameters, parser };
+
+	bool help = parser.defaultHelpFlag()
+		.getValue();
+
+	if (help)
+	{
+		parser.showHelp();
+		return ExitCode::Success;
+	}
+
+	if (parser.hasErrors())
+	{
+		return ExitCode::ParameterError;
+	}
+
+	if (commonParameters.shaderPath.empty())
+	{
+		std::cerr << "-shader required" << std::endl;
+		return ExitCode::ParameterError;
+	}
+
+	if (commonParameters.dacCount <= 0 || measureDuration <= 0.f)
+	{
+		std::cerr << "Invalid parameters." << std::endl;
+		return ExitCode::ParameterError;
+	}
+
+	if (nullOutput.initialize() != InitializationStatus::Success)
+	{
+		return ExitCode::ParameterError;
+	}
+
+	std::vector<int> pointCounts;
+	if (!parsePointCounts(pointCountsDescription, pointCounts))
+	{
+		std::cerr << "Invalid point counts." << std::endl;
+		return ExitCode::ParameterError;
+	}
+
+	auto maxPointCount = *std::max_element(pointCounts.begin(), pointCounts.end());
+
+	BatchArena pipelineArena{ false };
+
+	PointStageContext stageContext;
+	stageContext.pointsPerSecond = commonParameters.pointsPerSecond;
+	stageContext.fileWatcher = nullptr;
+
+	std::vector<PointPipeline> pipelines(commonParameters.dacCount);
+	for (int dacIndex = 0; dacIndex < commonParameters.dacCount; ++dacIndex)
+	{
+		auto &pipeline = pipelines[dacIndex];
+		stageContext.dacIndex = dacIndex;
+
+		if (pipelineDescription && !pipeline.parse(pipelineDescription, stageContext))
+		{
+			return ExitCode::ParameterError;
+		}
+	}
+
+	auto bufferCapacity = PointPipeline::getMaxCapacity(pipelines, maxPointCount);
+	for (auto &pipeline : pipelines)
+	{
+		pipeline.allocate(maxPointCount, pipelineArena, bufferCapacity);
+	}
+
+	if (!contextCreate())
+	{
+		std::cerr << "Context creation failed." << std::endl;
+		return ExitCode::ContextCreationFailed;
+	}
+
+	auto err = glewInit();
+	if (err != GLEW_OK)
+	{
+		std::cerr << glewGetErrorString(err) << std::endl;
+		return ExitCode::ExtensionsInitializationFailed;
+	}
+
+	auto exitCode = run(pointCounts, pipelines, consoleOutput, nullOutput);
+
+	contextDestroy();
+
+	return exitCode;
+}
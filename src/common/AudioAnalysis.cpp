@@ -0,0 +1,192 @@
+#include "AudioAnalysis.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+#include "audio.hpp"
+
+static const float Pi = 3.14159265f;
+
+static const float MinFrequency = 40.f;
+static const float MaxFrequency = 16000.f;
+
+// Band levels map this range of decibels to [0, 1].
+static const float MinDecibels = -80.f;
+
+// Time for the onset envelope to decay by 1/e, in seconds.
+static const float OnsetDecay = .1f;
+
+// In-place radix-2 FFT, size being a power of two.
+static void fft(std::vector<std::complex<float>> &data)
+{
+	auto size = data.size();
+
+	for (size_t i = 1, j = 0; i < size; ++i)
+	{
+		auto bit = size >> 1;
+		for (; j & bit; bit >>= 1)
+		{
+			j ^= bit;
+		}
+		j ^= bit;
+
+		if (i < j)
+		{
+			std::swap(data[i], data[j]);
+		}
+	}
+
+	for (size_t length = 2; length <= size; length <<= 1)
+	{
+		auto angle = -2.f * Pi / length;
+		std::complex<float> step{ std::cos(angle), std::sin(angle) };
+		for (size_t start = 0; start < size; start += length)
+		{
+			std::complex<float> twiddle{ 1.f, 0.f };
+			for (size_t k = 0; k < length / 2; ++k)
+			{
+				auto even = data[start + k];
+				auto odd = data[start + k + length / 2] * twiddle;
+				data[start + k] = even + odd;
+				data[start + k + length / 2] = even - odd;
+				twiddle *= step;
+			}
+		}
+	}
+}
+
+AudioAnalysis::~AudioAnalysis()
+{
+	stopping = true;
+	if (thread.joinable())
+	{
+		thread.join();
+	}
+}
+
+bool AudioAnalysis::start(const std::string &path)
+{
+	if (!audioReadWav(path, samples, sampleRate))
+	{
+		return false;
+	}
+
+	windowCount = (int)(samples.size() / HopSize) + 1;
+	values.assign(windowCount * ValuesPerWindow, 0.f);
+
+	thread = std::thread{ &AudioAnalysis::analyze, this };
+	return true;
+}
+
+void AudioAnalysis::finish()
+{
+	if (thread.joinable())
+	{
+		thread.join();
+	}
+}
+
+void AudioAnalysis::analyze()
+{
+	const int binCount = WindowSize / 2;
+
+	std::vector<float> window(WindowSize);
+	auto windowSum = 0.f;
+	for (int index = 0; index < WindowSize; ++index)
+	{
+		window[index] = .5f - .5f * std::cos(2.f * Pi * index / WindowSize);
+		windowSum += window[index];
+	}
+
+	// Log-spaced band edges, in bins.
+	int bandEdges[BandCount + 1];
+	auto maxFrequency = std::min(MaxFrequency, sampleRate * .5f);
+	for (int band = 0; band <= BandCount; ++band)
+	{
+		auto frequency = MinFrequency * std::pow(maxFrequency / MinFrequency, (float)band / BandCount);
+		bandEdges[band] = std::min(binCount, std::max(1, (int)std::lround(frequency * WindowSize / sampleRate)));
+	}
+	for (int band = 1; band <= BandCount; ++band)
+	{
+		bandEdges[band] = std::max(bandEdges[band], bandEdges[band - 1] + 1);
+	}
+
+	std::vector<std::complex<float>> spectrum(WindowSize);
+	std::vector<float> magnitudes(binCount);
+	std::vector<float> previousMagnitudes(binCount, 0.f);
+	auto onsetDecay = std::exp(-(float)HopSize / (sampleRate * OnsetDecay));
+	auto onset = 0.f;
+
+	for (int windowIndex = 0; windowIndex < windowCount && !stopping; ++windowIndex)
+	{
+		// Windows are centered on their time.
+		auto first = (long)windowIndex * HopSize - WindowSize / 2;
+		for (int index = 0; index < WindowSize; ++index)
+		{
+			auto sampleIndex = first + index;
+			auto sample = (sampleIndex >= 0 && sampleIndex < (long)samples.size()) ? samples[sampleIndex] : 0.f;
+			spectrum[index] = std::complex<float>{ sample * window[index], 0.f };
+		}
+
+		fft(spectrum);
+
+		// A full-scale sine has a magnitude of 1.
+		auto flux = 0.f;
+		auto total = 0.f;
+		for (int bin = 0; bin < binCount; ++bin)
+		{
+			magnitudes[bin] = std::abs(spectrum[bin]) * 2.f / windowSum;
+			flux += std::max(0.f, magnitudes[bin] - previousMagnitudes[bin]);
+			total += magnitudes[bin];
+		}
+		std::swap(magnitudes, previousMagnitudes);
+
+		auto windowValues = values.data() + windowIndex * ValuesPerWindow;
+		for (int band = 0; band < BandCount; ++band)
+		{
+			auto level = 0.f;
+			for (int bin = bandEdges[band]; bin < bandEdges[band + 1] && bin < binCount; ++bin)
+			{
+				level = std::max(level, previousMagnitudes[bin]);
+			}
+			auto decibels = 20.f * std::log10(level + 1e-9f);
+			windowValues[band] = std::min(std::max(1.f - decibels / MinDecibels, 0.f), 1.f);
+		}
+
+		// Spectral flux relative to the spectrum level, so that onsets do not depend on the volume.
+		auto relativeFlux = total > 1e-6f ? flux / total : 0.f;
+		onset = std::max(std::min(relativeFlux, 1.f), onset * onsetDecay);
+		windowValues[BandCount] = onset;
+
+		computedWindowCount.store(windowIndex + 1, std::memory_order_release);
+	}
+}
+
+void AudioAnalysis::sample(double time, float bands[BandCount], float &onset) const
+{
+	std::fill(bands, bands + BandCount, 0.f);
+	onset = 0.f;
+
+	auto position = time * sampleRate / HopSize;
+	if (position < 0. || sampleRate == 0)
+	{
+		return;
+	}
+
+	auto index = (int)position;
+	auto computedCount = computedWindowCount.load(std::memory_order_acquire);
+	if (index + 1 >= computedCount)
+	{
+		return;
+	}
+
+	auto fraction = (float)(position - index);
+	auto current = values.data() + index * ValuesPerWindow;
+	auto next = current + ValuesPerWindow;
+	for (int band = 0; band < BandCount; ++band)
+	{
+		bands[band] = current[band] + (next[band] - current[band]) * fraction;
+	}
+	onset = current[BandCount] + (next[BandCount] - current[BandCount]) * fraction;
+}
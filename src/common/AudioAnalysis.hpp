@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Frequency bands and onset envelope of an audio file, computed ahead of time on a background thread, so that the
+// render loop only looks them up.
+class AudioAnalysis
+{
+public:
+	static const int BandCount = 16;
+
+	// Samples per FFT window, and between consecutive windows.
+	static const int WindowSize = 2048;
+	static const int HopSize = 512;
+
+	~AudioAnalysis();
+
+	// Decodes the file and starts the analysis. Returns false if the file is invalid.
+	bool start(const std::string &path);
+
+	// Blocks until every window is computed, so that sampled values do not depend on the analysis speed, e.g. in
+	// offline mode.
+	void finish();
+
+	// Values at the given time of the file, in [0, 1], interpolated between windows. Values which are not yet
+	// computed, or beyond the end of the file, are 0.
+	void sample(double time, float bands[BandCount], float &onset) const;
+
+private:
+	// Per window, the bands then the onset.
+	static const int ValuesPerWindow = BandCount + 1;
+
+	std::vector<float> samples;
+	int sampleRate{ 0 };
+
+	std::vector<float> values;
+	int windowCount{ 0 };
+	std::atomic<int> computedWindowCount{ 0 };
+
+	std::thread thread;
+	std::atomic<bool> stopping{ false };
+
+	void analyze();
+};
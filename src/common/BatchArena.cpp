@@ -0,0 +1,67 @@
+#include "BatchArena.hpp"
+
+#include "system.hpp"
+
+BatchArena::BatchArena(bool hugePages)
+	: hugePages{ hugePages }
+{
+}
+
+BatchArena::~BatchArena()
+{
+	for (auto &chunk : chunks)
+	{
+		systemFreePages(chunk.address, chunk.size, chunk.hugePages);
+	}
+}
+
+void *BatchArena::allocate(std::size_t size)
+{
+	size = (size + Alignment - 1) / Alignment * Alignment;
+
+	if (chunks.empty() || usedSize + size > chunks.back().size)
+	{
+		Chunk chunk;
+		chunk.size = (size + ChunkSize - 1) / ChunkSize * ChunkSize;
+		chunk.hugePages = hugePages;
+		chunk.address = static_cast<char *>(systemAllocatePages(chunk.size, chunk.hugePages));
+		if (!chunk.address)
+		{
+			return nullptr;
+		}
+
+		// Do not retry every chunk once huge pages are exhausted.
+		hugePages = chunk.hugePages;
+
+		// The remainder of the previous chunk is wasted, which only happens at startup.
+		chunks.push_back(chunk);
+		usedSize = 0;
+	}
+
+	auto address = chunks.back().address + usedSize;
+	usedSize += size;
+	return address;
+}
+
+std::size_t BatchArena::getReservedSize() const
+{
+	std::size_t size = 0;
+	for (auto &chunk : chunks)
+	{
+		size += chunk.size;
+	}
+	return size;
+}
+
+std::size_t BatchArena::getHugePageSize() const
+{
+	std::size_t size = 0;
+	for (auto &chunk : chunks)
+	{
+		if (chunk.hugePages)
+		{
+			size += chunk.size;
+		}
+	}
+	return size;
+}
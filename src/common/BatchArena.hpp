@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Memory for per-batch buffers, allocated at startup so that the streaming loop does not allocate.
+//
+// Memory is taken from chunks of whole pages, optionally huge pages to spare TLB misses, and only released when
+// the arena is destroyed. Allocations are aligned for SIMD and zeroed.
+class BatchArena
+{
+public:
+	static const std::size_t Alignment = 64;
+
+	// A huge page on most systems.
+	static const std::size_t ChunkSize = 2 * 1024 * 1024;
+
+	BatchArena(bool hugePages);
+	~BatchArena();
+
+	BatchArena(const BatchArena &) = delete;
+	BatchArena &operator=(const BatchArena &) = delete;
+
+	// Returns nullptr on failure.
+	void *allocate(std::size_t size);
+
+	template <typename T>
+	T *allocate(std::size_t count)
+	{
+		return static_cast<T *>(allocate(count * sizeof(T)));
+	}
+
+	// Total size of the chunks, and the part of it on huge pages.
+	std::size_t getReservedSize() const;
+	std::size_t getHugePageSize() const;
+
+private:
+	struct Chunk
+	{
+		char *address;
+		std::size_t size;
+		bool hugePages;
+	};
+
+	bool hugePages;
+	std::vector<Chunk> chunks;
+	std::size_t usedSize{ 0 }; // In the last chunk.
+};
@@ -0,0 +1,273 @@
+#include "BeamSimulationOutput.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+#include "image.hpp"
+#include "PointBuffer.hpp"
+
+BeamSimulationOutput::BeamSimulationOutput(const CommonParameters &commonParameters, cli::Parser &parser)
+	: Output{ commonParameters }
+{
+	imageSize = parser.option("image-size")
+		.alias("is")
+		.description("Width and height of the images, in pixels.")
+		.defaultValue("512")
+		.getValueAs<int>();
+
+	persistence = parser.option("persistence")
+		.alias("pe")
+		.description("Time for the beam trail to fade to 1/e, in seconds.")
+		.defaultValue("0.05")
+		.getValueAs<float>();
+
+	exposure = parser.option("exposure")
+		.alias("ex")
+		.description("Brightness of a single point.")
+		.defaultValue("1")
+		.getValueAs<float>();
+
+	frameRate = parser.option("frame-rate")
+		.alias("fr")
+		.description("Images written per simulated second.")
+		.defaultValue("30")
+		.getValueAs<float>();
+
+	outputPath = parser.option("output-path")
+		.alias("op")
+		.description("Image path pattern, with a printf integer for the frame index and a .png or .ppm extension.")
+		.defaultValue("frame-%05d.png")
+		.getValueAs<std::string>();
+
+	threadCount = parser.option("thread-count")
+		.alias("tc")
+		.description("Simulation threads, 0 for the number of cores.")
+		.defaultValue("0")
+		.getValueAs<int>();
+
+	realTime = parser.flag("real-time")
+		.alias("rt")
+		.description("Paces batches at the laser rate instead of simulating as fast as possible.")
+		.getValue();
+}
+
+InitializationStatus BeamSimulationOutput::initialize()
+{
+	if (imageSize <= 0 || persistence <= 0.f || frameRate <= 0.f)
+	{
+		std::cerr << "Image size, persistence and frame rate must be positive." << std::endl;
+		return InitializationStatus::Failure;
+	}
+
+	if (threadCount <= 0)
+	{
+		threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+	}
+	workerPool.reset(new WorkerPool{ threadCount });
+
+	auto pixelCount = (std::size_t)imageSize * imageSize * 3;
+	accumulation.resize(pixelCount * commonParameters.dacCount);
+
+	layers.resize(threadCount);
+	for (auto &layer : layers)
+	{
+		layer.pixels.resize(pixelCount);
+		layer.minRow = imageSize;
+		layer.maxRow = -1;
+	}
+
+	lastPoints.resize(commonParameters.dacCount, Point{ 0.f, 0.f, 0.f, 0.f, 0.f });
+	image.resize((std::size_t)imageSize * imageSize * 3 * commonParameters.dacCount);
+
+	return InitializationStatus::Success;
+}
+
+bool BeamSimulationOutput::needPoints()
+{
+	return !realTime || isNextBatchDue();
+}
+
+void BeamSimulationOutput::drawSegments(Layer &layer, const PointBuffer &buffer, int begin, int end, const Point &previousPoint) const
+{
+	auto halfSize = imageSize * .5f;
+
+	auto previousX = (previousPoint.x + 1.f) * halfSize;
+	auto previousY = (1.f - previousPoint.y) * halfSize;
+	if (begin > 0)
+	{
+		previousX = (buffer.x[begin - 1] + 1.f) * halfSize;
+		previousY = (1.f - buffer.y[begin - 1]) * halfSize;
+	}
+
+	for (int index = begin; index < end; ++index)
+	{
+		auto x = (buffer.x[index] + 1.f) * halfSize;
+		auto y = (1.f - buffer.y[index]) * halfSize;
+
+		// One sample per pixel along the segment, sharing the energy of a single point.
+		auto length = std::max(std::fabs(x - previousX), std::fabs(y - previousY));
+		auto sampleCount = std::max(1, (int)std::ceil(length));
+		auto weight = exposure / sampleCount;
+		auto r = buffer.r[index] * weight;
+		auto g = buffer.g[index] * weight;
+		auto b = buffer.b[index] * weight;
+
+		if (r > 0.f || g > 0.f || b > 0.f)
+		{
+			auto stepX = (x - previousX) / sampleCount;
+			auto stepY = (y - previousY) / sampleCount;
+			auto sampleX = previousX + stepX;
+			auto sampleY = previousY + stepY;
+
+			for (int sample = 0; sample < sampleCount; ++sample, sampleX += stepX, sampleY += stepY)
+			{
+				auto column = (int)sampleX;
+				auto row = (int)sampleY;
+				if (sampleX < 0.f || sampleY < 0.f || column >= imageSize || row >= imageSize)
+				{
+					continue;
+				}
+
+				auto pixel = &layer.pixels[((std::size_t)row * imageSize + column) * 3];
+				pixel[0] += r;
+				pixel[1] += g;
+				pixel[2] += b;
+
+				layer.minRow = std::min(layer.minRow, row);
+				layer.maxRow = std::max(layer.maxRow, row);
+			}
+		}
+
+		previousX = x;
+		previousY = y;
+	}
+}
+
+void BeamSimulationOutput::mergeLayers(float *dacAccumulation, float decay, int workerIndex)
+{
+	// Rows are distributed among workers, layers are summed in a fixed order so that results are deterministic.
+	auto rowsPerWorker = (imageSize + threadCount - 1) / threadCount;
+	auto beginRow = workerIndex * rowsPerWorker;
+	auto endRow = std::min(imageSize, beginRow + rowsPerWorker);
+	auto rowSize = (std::size_t)imageSize * 3;
+
+	for (int row = beginRow; row < endRow; ++row)
+	{
+		auto destination = dacAccumulation + row * rowSize;
+		for (std::size_t i = 0; i < rowSize; ++i)
+		{
+			destination[i] *= decay;
+		}
+
+		for (auto &layer : layers)
+		{
+			if (row < layer.minRow || row > layer.maxRow)
+			{
+				continue;
+			}
+
+			auto source = &layer.pixels[row * rowSize];
+			for (std::size_t i = 0; i < rowSize; ++i)
+			{
+				destination[i] += source[i];
+				source[i] = 0.f;
+			}
+		}
+	}
+}
+
+bool BeamSimulationOutput::streamPoints(const PointBuffer *buffers)
+{
+	auto batchDuration = (double)buffers[0].count / commonParameters.pointsPerSecond;
+	auto decay = (float)std::exp(-batchDuration / persistence);
+	auto pixelCount = (std::size_t)imageSize * imageSize * 3;
+
+	for (int dacIndex = 0; dacIndex < commonParameters.dacCount; ++dacIndex)
+	{
+		auto &buffer = buffers[dacIndex];
+		auto dacAccumulation = &accumulation[pixelCount * dacIndex];
+		auto &previousPoint = lastPoints[dacIndex];
+
+		workerPool->run([&](int workerIndex)
+		{
+			// Each worker draws a contiguous range of segments into its own layer.
+			auto pointsPerWorker = (buffer.count + threadCount - 1) / threadCount;
+			auto begin = std::min(buffer.count, workerIndex * pointsPerWorker);
+			auto end = std::min(buffer.count, begin + pointsPerWorker);
+			drawSegments(layers[workerIndex], buffer, begin, end, previousPoint);
+		});
+
+		workerPool->run([&](int workerIndex)
+		{
+			mergeLayers(dacAccumulation, decay, workerIndex);
+		});
+
+		for (auto &layer : layers)
+		{
+			layer.minRow = imageSize;
+			layer.maxRow = -1;
+		}
+
+		if (buffer.count > 0)
+		{
+			previousPoint = buffer.get(buffer.count - 1);
+		}
+	}
+
+	simulatedTime += batchDuration;
+	while (simulatedTime >= frameIndex / frameRate)
+	{
+		if (!writeFrame())
+		{
+			return false;
+		}
+		++frameIndex;
+	}
+
+	if (realTime)
+	{
+		scheduleNextBatch(buffers[0].count);
+	}
+
+	return true;
+}
+
+bool BeamSimulationOutput::writeFrame()
+{
+	// DACs are laid side by side.
+	auto width = imageSize * commonParameters.dacCount;
+	auto pixelCount = (std::size_t)imageSize * imageSize * 3;
+
+	for (int dacIndex = 0; dacIndex < commonParameters.dacCount; ++dacIndex)
+	{
+		auto dacAccumulation = &accumulation[pixelCount * dacIndex];
+		for (int row = 0; row < imageSize; ++row)
+		{
+			auto source = dacAccumulation + (std::size_t)row * imageSize * 3;
+			auto destination = &image[((std::size_t)row * width + dacIndex * imageSize) * 3];
+			for (int i = 0; i < imageSize * 3; ++i)
+			{
+				destination[i] = (uint8_t)(std::min(source[i], 1.f) * 255.f + .5f);
+			}
+		}
+	}
+
+	char path[4096];
+	std::snprintf(path, sizeof(path), outputPath.c_str(), frameIndex);
+
+	if (!imageWrite(path, width, imageSize, image.data()))
+	{
+		std::cerr << "Cannot write " << path << "." << std::endl;
+		return false;
+	}
+
+	if (commonParameters.verbose)
+	{
+		std::cout << "Wrote " << path << "." << std::endl;
+	}
+
+	return true;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cli.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Output.hpp"
+#include "WorkerPool.hpp"
+
+// Simulates the beam on the CPU, and writes the resulting images.
+//
+// The beam travels along straight lines between consecutive points, each segment lasting 1 / pps and depositing
+// the color of its end point. The accumulated energy decays with the configured persistence, which is applied
+// once per batch.
+class BeamSimulationOutput : public Output
+{
+public:
+	BeamSimulationOutput(const CommonParameters &commonParameters, cli::Parser &parser);
+
+	InitializationStatus initialize() override;
+
+	bool needPoints() override;
+	bool streamPoints(const PointBuffer *buffers) override;
+
+private:
+	struct Layer
+	{
+		std::vector<float> pixels;
+		int minRow;
+		int maxRow;
+	};
+
+	int imageSize;
+	float persistence;
+	float exposure;
+	float frameRate;
+	std::string outputPath;
+	int threadCount;
+	bool realTime;
+
+	std::unique_ptr<WorkerPool> workerPool;
+
+	std::vector<float> accumulation; // Per DAC.
+	std::vector<Layer> layers; // Per worker.
+	std::vector<Point> lastPoints; // Per DAC.
+	std::vector<uint8_t> image;
+
+	double simulatedTime{ 0. };
+	int frameIndex{ 0 };
+
+	void drawSegments(Layer &layer, const PointBuffer &buffer, int begin, int end, const Point &previousPoint) const;
+	void mergeLayers(float *dacAccumulation, float decay, int workerIndex);
+	bool writeFrame();
+};
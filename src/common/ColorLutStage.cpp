@@ -0,0 +1,251 @@
+#include "ColorLutStage.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "FileWatcher.hpp"
+
+// Fixed-point scale of lookup positions, whose low bits are the interpolation fraction. Differences of 16-bit
+// values times the fraction fit in 31 bits.
+static const int FractionBits = 15;
+static const float PositionScale = (float)(ColorLutStage::TableSize << FractionBits);
+static const float OutputScale = 1.f / 65535.f;
+
+// Clamps a color to [0, 1]. NaN, which std::min and std::max keep, gives 0 so that lookups stay in the tables.
+static float saturate(float value)
+{
+	return value > 0.f ? std::min(value, 1.f) : 0.f;
+}
+
+ColorLutStage::ColorLutStage(const std::string &path, FileWatcher *fileWatcher)
+	: path{ path }
+	, calibration{ new Calibration{} }
+{
+	if (fileWatcher)
+	{
+		fileWatcher->watchFile(path, [this]()
+		{
+			auto newCalibration = build();
+			if (!newCalibration)
+			{
+				return;
+			}
+
+			std::lock_guard<std::mutex> lock{ pendingCalibrationMutex };
+			pendingCalibration = std::move(newCalibration);
+			pendingCalibrationReady = true;
+		});
+	}
+}
+
+bool ColorLutStage::load()
+{
+	auto newCalibration = build();
+	if (!newCalibration)
+	{
+		return false;
+	}
+
+	calibration = std::move(newCalibration);
+	return true;
+}
+
+std::unique_ptr<ColorLutStage::Calibration> ColorLutStage::build() const
+{
+	std::ifstream file{ path };
+	if (!file)
+	{
+		std::cerr << "Unable to open color LUT file: " << path << std::endl;
+		return nullptr;
+	}
+
+	std::vector<float> values[3];
+	std::vector<float> newCube;
+	int newCubeSize = 0;
+	size_t cubeValueCount = 0;
+
+	std::string line;
+	while (std::getline(file, line))
+	{
+		line = line.substr(0, line.find('#'));
+
+		std::istringstream lineStream{ line };
+
+		// Cube values follow the cube line, possibly with comments and blank lines in between.
+		if (cubeValueCount < newCube.size())
+		{
+			float value;
+			while (cubeValueCount < newCube.size() && lineStream >> value)
+			{
+				newCube[cubeValueCount++] = value;
+			}
+
+			if (!(lineStream >> std::ws).eof())
+			{
+				std::cerr << "Invalid color LUT cube values: " << path << std::endl;
+				return nullptr;
+			}
+			continue;
+		}
+
+		std::string keyword;
+		if (!(lineStream >> keyword))
+		{
+			continue;
+		}
+
+		static const std::string channelNames = "rgb";
+		auto channel = channelNames.find(keyword);
+		if (keyword.size() == 1 && channel != std::string::npos)
+		{
+			float value;
+			while (lineStream >> value)
+			{
+				values[channel].push_back(value);
+			}
+
+			if (!lineStream.eof() || values[channel].size() < 2)
+			{
+				std::cerr << "Invalid color LUT channel: " << path << std::endl;
+				return nullptr;
+			}
+		}
+		else if (keyword == "cube" && newCube.empty() && lineStream >> newCubeSize && newCubeSize >= 2)
+		{
+			newCube.resize(newCubeSize * newCubeSize * newCubeSize * 3);
+		}
+		else
+		{
+			std::cerr << "Invalid color LUT line: " << line << std::endl;
+			return nullptr;
+		}
+	}
+
+	if (cubeValueCount < newCube.size())
+	{
+		std::cerr << "Missing color LUT cube values: " << path << std::endl;
+		return nullptr;
+	}
+
+	std::unique_ptr<Calibration> newCalibration{ new Calibration{} };
+	for (int channel = 0; channel < 3; ++channel)
+	{
+		auto &channelValues = values[channel];
+		auto &table = newCalibration->tables[channel];
+		if (channelValues.empty())
+		{
+			continue;
+		}
+
+		// Resamples linearly.
+		table.resize(TableSize + 1);
+		auto lastIndex = (float)(channelValues.size() - 1);
+		for (int index = 0; index <= TableSize; ++index)
+		{
+			auto position = (float)index / TableSize * lastIndex;
+			auto integer = std::min((int)position, (int)lastIndex - 1);
+			auto fraction = position - integer;
+			auto value = channelValues[integer] + (channelValues[integer + 1] - channelValues[integer]) * fraction;
+			table[index] = (uint16_t)std::lround(std::min(std::max(value, 0.f), 1.f) * 65535.f);
+		}
+	}
+
+	newCalibration->cubeSize = newCubeSize;
+	newCalibration->cube = std::move(newCube);
+
+	return newCalibration;
+}
+
+bool ColorLutStage::isPointwise() const
+{
+	return true;
+}
+
+void ColorLutStage::applyCube(PointBuffer &buffer, int begin, int end) const
+{
+	auto cubeSize = calibration->cubeSize;
+	auto &cube = calibration->cube;
+	auto maxIndex = (float)(cubeSize - 1);
+	auto lastCell = cubeSize - 2;
+	auto rowStride = cubeSize * 3;
+	auto sliceStride = cubeSize * cubeSize * 3;
+
+	for (int i = begin; i < end; ++i)
+	{
+		float positions[3] = { buffer.r[i], buffer.g[i], buffer.b[i] };
+		int cells[3];
+		float fractions[3];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			auto position = saturate(positions[axis]) * maxIndex;
+			cells[axis] = std::min((int)position, lastCell);
+			fractions[axis] = position - cells[axis];
+		}
+
+		// Trilinear interpolation between the 8 corners.
+		auto corner = cube.data() + cells[2] * sliceStride + cells[1] * rowStride + cells[0] * 3;
+		float result[3] = { 0.f, 0.f, 0.f };
+		for (int index = 0; index < 8; ++index)
+		{
+			auto dr = index & 1;
+			auto dg = (index >> 1) & 1;
+			auto db = (index >> 2) & 1;
+			auto weight = (dr ? fractions[0] : 1.f - fractions[0]) * (dg ? fractions[1] : 1.f - fractions[1]) * (db ? fractions[2] : 1.f - fractions[2]);
+			auto values = corner + db * sliceStride + dg * rowStride + dr * 3;
+			result[0] += weight * values[0];
+			result[1] += weight * values[1];
+			result[2] += weight * values[2];
+		}
+
+		buffer.r[i] = result[0];
+		buffer.g[i] = result[1];
+		buffer.b[i] = result[2];
+	}
+}
+
+void ColorLutStage::beginBatch()
+{
+	if (pendingCalibrationReady.exchange(false))
+	{
+		std::lock_guard<std::mutex> lock{ pendingCalibrationMutex };
+		calibration = std::move(pendingCalibration);
+	}
+}
+
+bool ColorLutStage::hasPendingChange() const
+{
+	return pendingCalibrationReady;
+}
+
+void ColorLutStage::processRange(PointBuffer &buffer, int begin, int end)
+{
+	if (calibration->cubeSize > 0)
+	{
+		applyCube(buffer, begin, end);
+	}
+
+	float *channels[3] = { buffer.r, buffer.g, buffer.b };
+	for (int channel = 0; channel < 3; ++channel)
+	{
+		auto &table = calibration->tables[channel];
+		if (table.empty())
+		{
+			continue;
+		}
+
+		auto values = channels[channel];
+		auto entries = table.data();
+		for (int i = begin; i < end; ++i)
+		{
+			auto position = (int32_t)(saturate(values[i]) * PositionScale);
+			auto index = std::min(position >> FractionBits, TableSize - 1);
+			auto fraction = position - (index << FractionBits);
+			auto low = (int32_t)entries[index];
+			auto high = (int32_t)entries[index + 1];
+			values[i] = (float)(low + (((high - low) * fraction) >> FractionBits)) * OutputScale;
+		}
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "PointStage.hpp"
+
+class FileWatcher;
+
+// Maps colors through a calibration file, to compensate the non-linear response and threshold of the diodes.
+//
+// The file holds lines "r v0 v1 ...", "g ..." and "b ...", each being a 1D LUT of a channel with values for
+// evenly spaced inputs from 0 to 1. Missing channels are left unchanged. An optional "cube n" line followed by
+// n^3 "r g b" triplets, red varying fastest, is a 3D LUT applied before the 1D ones, e.g. for white balance.
+// Text after # is ignored.
+//
+// The file is reloaded on the file watcher thread when it changes, and swapped in before the next batch. If the new
+// content is invalid, the previous calibration is kept.
+class ColorLutStage : public PointStage
+{
+public:
+	// 1D LUTs are resampled to this many segments, so that lookups are done in fixed point.
+	static const int TableBits = 10;
+	static const int TableSize = 1 << TableBits;
+
+	// fileWatcher may be null.
+	ColorLutStage(const std::string &path, FileWatcher *fileWatcher);
+
+	// Returns false if the file is invalid.
+	bool load();
+
+	bool isPointwise() const override;
+	void beginBatch() override;
+	bool hasPendingChange() const override;
+	void processRange(PointBuffer &buffer, int begin, int end) override;
+
+private:
+	struct Calibration
+	{
+		// Per channel, TableSize + 1 values in 16-bit fixed point, or empty for identity.
+		std::vector<uint16_t> tables[3];
+
+		int cubeSize{ 0 };
+		std::vector<float> cube;
+	};
+
+	std::string path;
+
+	std::unique_ptr<Calibration> calibration;
+	std::unique_ptr<Calibration> pendingCalibration;
+	std::mutex pendingCalibrationMutex;
+	std::atomic<bool> pendingCalibrationReady{ false };
+
+	// Returns null if the file is invalid.
+	std::unique_ptr<Calibration> build() const;
+
+	void applyCube(PointBuffer &buffer, int begin, int end) const;
+};
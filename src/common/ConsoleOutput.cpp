@@ -2,6 +2,7 @@
 
 #include <algorithm>
 
+#include "PointBuffer.hpp"
 #include "system.hpp"
 
 ConsoleOutput::ConsoleOutput(const CommonParameters &commonParameters, cli::Parser &parser)
@@ -30,13 +31,21 @@ bool ConsoleOutput::needPoints()
 	return true;
 }
 
-bool ConsoleOutput::streamPoints(const Point *data)
+bool ConsoleOutput::streamPoints(const PointBuffer *buffers)
 {
-	auto count = limitPoints > 0 ? std::min(limitPoints, commonParameters.pointCount) : commonParameters.pointCount;
-
-	for (int i = 0; i < count; ++i)
+	for (int dacIndex = 0; dacIndex < commonParameters.dacCount; ++dacIndex)
 	{
-		std::cout << data[i] << std::endl;
+		if (commonParameters.dacCount > 1)
+		{
+			std::cout << "DAC " << dacIndex << ":" << std::endl;
+		}
+
+		auto &buffer = buffers[dacIndex];
+		auto count = limitPoints > 0 ? std::min(limitPoints, buffer.count) : buffer.count;
+		for (int i = 0; i < count; ++i)
+		{
+			std::cout << buffer.get(i) << std::endl;
+		}
 	}
 
 	systemPause(pauseDuration);
@@ -12,7 +12,7 @@ public:
 	InitializationStatus initialize() override;
 
 	bool needPoints() override;
-	bool streamPoints(const Point *data) override;
+	bool streamPoints(const PointBuffer *buffers) override;
 
 private:
 	int limitPoints;
@@ -1,5 +1,78 @@
 #include "FileWatcher.hpp"
 
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+#if defined(SYSTEM_LINUX)
+#include <cerrno>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+const std::chrono::milliseconds FileWatcher::DebounceDuration{ 50 };
+
+#if defined(SYSTEM_LINUX)
+// Rewriting in place ends with IN_CLOSE_WRITE, saving to a temporary file and renaming it with IN_MOVED_TO.
+static const uint32_t CompleteEventMask = IN_CLOSE_WRITE | IN_MOVED_TO;
+static const uint32_t EventMask = CompleteEventMask | IN_MODIFY | IN_CREATE;
+#endif
+
+FileWatcher::FileWatcher()
+{
+#if defined(SYSTEM_LINUX)
+	inotifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotifyDescriptor < 0)
+	{
+		std::cerr << "Unable to create the file watcher, files will not be reloaded." << std::endl;
+	}
+
+	stopDescriptor = eventfd(0, EFD_CLOEXEC);
+#else
+	listener.fileWatcher = this;
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#if defined(SYSTEM_LINUX)
+	if (thread.joinable())
+	{
+		uint64_t value = 1;
+		if (write(stopDescriptor, &value, sizeof(value)) == sizeof(value))
+		{
+			thread.join();
+		}
+		else
+		{
+			thread.detach();
+		}
+	}
+
+	if (inotifyDescriptor >= 0)
+	{
+		close(inotifyDescriptor);
+	}
+
+	if (stopDescriptor >= 0)
+	{
+		close(stopDescriptor);
+	}
+#else
+	if (thread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			stopping = true;
+		}
+		condition.notify_one();
+		thread.join();
+	}
+#endif
+}
+
 void FileWatcher::watchFile(const std::string &path, callback_t callback)
 {
 	auto namePair = systemSplitDirectoryNameAndBaseName(path);
@@ -8,33 +81,248 @@ void FileWatcher::watchFile(const std::string &path, callback_t callback)
 		return;
 	}
 
-	auto watchID = internalFileWatcher.addWatch(std::get<0>(namePair), &listener, false);
+	std::lock_guard<std::mutex> lock{ mutex };
+
+	auto &directory = std::get<0>(namePair);
+	auto it = watchIDByDirectories.find(directory);
+	if (it == std::end(watchIDByDirectories))
+	{
+#if defined(SYSTEM_LINUX)
+		auto watchID = inotify_add_watch(inotifyDescriptor, directory.c_str(), EventMask);
+#else
+		auto watchID = internalFileWatcher.addWatch(directory, &listener, false);
+#endif
+		if (watchID < 0)
+		{
+			return;
+		}
+
+		it = watchIDByDirectories.emplace(directory, watchID).first;
+	}
+
+	std::unique_ptr<File> file{ new File };
+	file->path = path;
+	file->baseName = std::get<1>(namePair);
+	file->callback = callback;
+
+	if (started)
+	{
+		file->exists = hashFile(path, file->hash);
+	}
 
-	listener.descriptorByWatchIDs.emplace(watchID, std::make_tuple(std::get<1>(namePair), callback));
+	fileByWatchIDs.emplace(it->second, file.get());
+	files.push_back(std::move(file));
 }
 
 void FileWatcher::start()
 {
+	for (auto &file : files)
+	{
+		file->exists = hashFile(file->path, file->hash);
+		file->callback();
+	}
+
+#if !defined(SYSTEM_LINUX)
 	internalFileWatcher.watch();
+#endif
+
+	std::lock_guard<std::mutex> lock{ mutex };
+	started = true;
+
+	thread = std::thread{ &FileWatcher::run, this };
+}
+
+void FileWatcher::notify(watch_id_t watchID, const std::string &baseName, bool complete)
+{
+	std::lock_guard<std::mutex> lock{ mutex };
+
+	auto range = fileByWatchIDs.equal_range(watchID);
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		auto file = it->second;
+		if (file->baseName == baseName && (complete || file->pending))
+		{
+			file->pending = true;
+			file->dueTime = Clock::now() + DebounceDuration;
+		}
+	}
+
+#if !defined(SYSTEM_LINUX)
+	notified = true;
+#endif
+}
+
+bool FileWatcher::dispatch(Clock::time_point &nextDueTime)
+{
+	std::vector<File *> dueFiles;
+	bool pending = false;
+
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+
+		auto now = Clock::now();
+		for (auto &file : files)
+		{
+			if (!file->pending)
+			{
+				continue;
+			}
+
+			if (file->dueTime <= now)
+			{
+				file->pending = false;
+				dueFiles.push_back(file.get());
+			}
+			else if (!pending || file->dueTime < nextDueTime)
+			{
+				pending = true;
+				nextDueTime = file->dueTime;
+			}
+		}
+	}
 
-	for (auto it : listener.descriptorByWatchIDs)
+	// Only this thread accesses hashes, and callbacks are called without holding the lock.
+	for (auto file : dueFiles)
 	{
-		std::get<1>(it.second)();
+		uint64_t hash;
+		if (!hashFile(file->path, hash))
+		{
+			// Removed, another event comes when it is written again.
+			file->exists = false;
+			continue;
+		}
+
+		if (file->exists && hash == file->hash)
+		{
+			continue;
+		}
+
+		file->exists = true;
+		file->hash = hash;
+		file->callback();
 	}
+
+	return pending;
 }
 
-void FileWatcher::Listener::handleFileAction(efsw::WatchID watchID, const std::string &, const std::string &filename, efsw::Action, std::string)
+bool FileWatcher::hashFile(const std::string &path, uint64_t &hash)
 {
-	auto it = descriptorByWatchIDs.find(watchID);
-	if (it == std::end(descriptorByWatchIDs))
+	std::ifstream stream{ path, std::ios::binary };
+	if (!stream)
 	{
-		return;
+		return false;
 	}
 
-	if (std::get<0>(it->second) != filename)
+	uint64_t value = 14695981039346656037ull;
+	char buffer[4096];
+	do
 	{
-		return;
+		stream.read(buffer, sizeof(buffer));
+		auto count = stream.gcount();
+		for (std::streamsize index = 0; index < count; ++index)
+		{
+			value = (value ^ (uint8_t)buffer[index]) * 1099511628211ull;
+		}
+	} while (stream);
+
+	hash = value;
+	return true;
+}
+
+#if defined(SYSTEM_LINUX)
+void FileWatcher::run()
+{
+	alignas(inotify_event) char buffer[4096];
+
+	for (;;)
+	{
+		int timeout = -1;
+
+		Clock::time_point nextDueTime;
+		if (dispatch(nextDueTime))
+		{
+			auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(nextDueTime - Clock::now()).count() + 1;
+			timeout = (int)std::max<int64_t>(remaining, 0);
+		}
+
+		pollfd descriptors[2] = {
+			{ inotifyDescriptor, POLLIN, 0 },
+			{ stopDescriptor, POLLIN, 0 },
+		};
+
+		if (poll(descriptors, 2, timeout) < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return;
+		}
+
+		if (descriptors[1].revents)
+		{
+			return;
+		}
+
+		if (!(descriptors[0].revents & POLLIN))
+		{
+			continue;
+		}
+
+		ssize_t length;
+		while ((length = read(inotifyDescriptor, buffer, sizeof(buffer))) > 0)
+		{
+			for (auto position = buffer; position < buffer + length;)
+			{
+				auto event = reinterpret_cast<const inotify_event *>(position);
+				if (event->len > 0)
+				{
+					notify(event->wd, event->name, (event->mask & CompleteEventMask) != 0);
+				}
+				position += sizeof(inotify_event) + event->len;
+			}
+		}
+	}
+}
+#else
+void FileWatcher::run()
+{
+	std::unique_lock<std::mutex> lock{ mutex };
+
+	while (!stopping)
+	{
+		lock.unlock();
+		Clock::time_point nextDueTime;
+		bool pending = dispatch(nextDueTime);
+		lock.lock();
+
+		if (stopping)
+		{
+			break;
+		}
+
+		// Notified while dispatching.
+		if (notified)
+		{
+			notified = false;
+			continue;
+		}
+
+		if (pending)
+		{
+			condition.wait_until(lock, nextDueTime);
+		}
+		else
+		{
+			condition.wait(lock);
+		}
 	}
+}
 
-	std::get<1>(it->second)();
+void FileWatcher::Listener::handleFileAction(efsw::WatchID watchID, const std::string &, const std::string &filename, efsw::Action, std::string)
+{
+	// efsw does not tell whether the writer closed the file, every event is complete.
+	fileWatcher->notify(watchID, filename, true);
+	fileWatcher->condition.notify_one();
 }
+#endif
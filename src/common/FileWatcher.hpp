@@ -1,30 +1,95 @@
 #pragma once
 
-#include <efsw/efsw.hpp>
+#include <chrono>
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
+
+#if !defined(SYSTEM_LINUX)
+#include <condition_variable>
+#include <efsw/efsw.hpp>
+#endif
 
 #include "system.hpp"
 
+// Calls back when the content of watched files changes.
+// Events are coalesced until the file has been quiet for DebounceDuration, and callbacks only fire if the content hash differs, so that an editor save (truncate, write, rename) triggers a single reload of the complete file, and saving identical content none.
 class FileWatcher
 {
 public:
 	using callback_t = std::function<void()>;
+	using Clock = std::chrono::steady_clock;
+
+	static const std::chrono::milliseconds DebounceDuration;
 
+	FileWatcher();
+	~FileWatcher();
+
+	// Files watched after start() are not called back until they change.
 	void watchFile(const std::string &path, callback_t callback);
 
+	// Calls every callback once, then watches in the background.
 	void start();
 
 private:
+#if defined(SYSTEM_LINUX)
+	using watch_id_t = int;
+#else
+	using watch_id_t = efsw::WatchID;
+#endif
+
+	struct File
+	{
+		std::string path;
+		std::string baseName;
+		callback_t callback;
+		uint64_t hash{ 0 };
+		bool exists{ false };
+		bool pending{ false };
+		Clock::time_point dueTime;
+	};
+
+	std::vector<std::unique_ptr<File>> files;
+
+	// Several files of the same directory share the directory watch.
+	std::unordered_map<std::string, watch_id_t> watchIDByDirectories;
+	std::unordered_multimap<watch_id_t, File *> fileByWatchIDs;
+
+	std::mutex mutex;
+	std::thread thread;
+	bool started{ false };
+
+	// A complete event (closed after writing, renamed to) schedules a callback, other ones only postpone a scheduled callback.
+	void notify(watch_id_t watchID, const std::string &baseName, bool complete);
+
+	// Calls back due files, returns whether other ones are pending and when the next one is due.
+	bool dispatch(Clock::time_point &nextDueTime);
+
+	static bool hashFile(const std::string &path, uint64_t &hash);
+
+	void run();
+
+#if defined(SYSTEM_LINUX)
+	int inotifyDescriptor{ -1 };
+	int stopDescriptor{ -1 };
+#else
 	class Listener : public efsw::FileWatchListener
 	{
 	public:
-		std::unordered_map<efsw::WatchID, std::tuple<std::string, callback_t>> descriptorByWatchIDs;
+		FileWatcher *fileWatcher;
 
 		void handleFileAction(efsw::WatchID watchID, const std::string &directory, const std::string &filename, efsw::Action action, std::string oldFilename = "") override;
 	};
 
 	efsw::FileWatcher internalFileWatcher;
 	Listener listener;
-};
\ No newline at end of file
+	std::condition_variable condition;
+	bool notified{ false };
+	bool stopping{ false };
+#endif
+};
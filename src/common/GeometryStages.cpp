@@ -0,0 +1,230 @@
+#include "GeometryStages.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+#include "simd.hpp"
+
+HomographyStage HomographyStage::keystone(float x, float y)
+{
+	const float matrix[9] = {
+		1.f, 0.f, 0.f,
+		0.f, 1.f, 0.f,
+		x, y, 1.f,
+	};
+	return HomographyStage{ matrix };
+}
+
+HomographyStage::HomographyStage(const float matrix[9])
+{
+	std::copy(matrix, matrix + 9, this->matrix);
+}
+
+bool HomographyStage::isPointwise() const
+{
+	return true;
+}
+
+bool HomographyStage::fuse(const PointStage &next)
+{
+	auto nextHomography = dynamic_cast<const HomographyStage *>(&next);
+	if (!nextHomography)
+	{
+		return false;
+	}
+
+	// Composes next after this.
+	auto &n = nextHomography->matrix;
+	float product[9];
+	for (int row = 0; row < 3; ++row)
+	{
+		for (int column = 0; column < 3; ++column)
+		{
+			product[row * 3 + column] = n[row * 3 + 0] * matrix[0 * 3 + column] + n[row * 3 + 1] * matrix[1 * 3 + column] + n[row * 3 + 2] * matrix[2 * 3 + column];
+		}
+	}
+	std::copy(product, product + 9, matrix);
+	return true;
+}
+
+void HomographyStage::processRange(PointBuffer &buffer, int begin, int end)
+{
+	auto x = buffer.x;
+	auto y = buffer.y;
+	auto &m = matrix;
+
+	// Points on or behind the horizon line have no projection: w is clamped so that they stay finite, and they are
+	// blanked.
+	const auto minW = 1e-6f;
+
+	int i = begin;
+#if defined(SIMD_SSE2)
+	__m128 ms[9];
+	for (int index = 0; index < 9; ++index)
+	{
+		ms[index] = _mm_set1_ps(m[index]);
+	}
+	auto minWs = _mm_set1_ps(minW);
+	for (; i + 4 <= end; i += 4)
+	{
+		auto px = _mm_loadu_ps(x + i);
+		auto py = _mm_loadu_ps(y + i);
+		auto qx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ms[0], px), _mm_mul_ps(ms[1], py)), ms[2]);
+		auto qy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ms[3], px), _mm_mul_ps(ms[4], py)), ms[5]);
+		auto w = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ms[6], px), _mm_mul_ps(ms[7], py)), ms[8]);
+
+		// Also true for NaN.
+		auto hidden = _mm_cmpnlt_ps(minWs, w);
+		w = _mm_max_ps(w, minWs);
+		_mm_storeu_ps(x + i, _mm_div_ps(qx, w));
+		_mm_storeu_ps(y + i, _mm_div_ps(qy, w));
+		_mm_storeu_ps(buffer.r + i, _mm_andnot_ps(hidden, _mm_loadu_ps(buffer.r + i)));
+		_mm_storeu_ps(buffer.g + i, _mm_andnot_ps(hidden, _mm_loadu_ps(buffer.g + i)));
+		_mm_storeu_ps(buffer.b + i, _mm_andnot_ps(hidden, _mm_loadu_ps(buffer.b + i)));
+	}
+#endif
+	for (; i < end; ++i)
+	{
+		auto px = x[i];
+		auto py = y[i];
+		auto w = m[6] * px + m[7] * py + m[8];
+		if (!(w > minW))
+		{
+			w = minW;
+			buffer.r[i] = 0.f;
+			buffer.g[i] = 0.f;
+			buffer.b[i] = 0.f;
+		}
+		x[i] = (m[0] * px + m[1] * py + m[2]) / w;
+		y[i] = (m[3] * px + m[4] * py + m[5]) / w;
+	}
+}
+
+RadialDistortionStage::RadialDistortionStage(float k1, float k2)
+	: k1{ k1 }, k2{ k2 }
+{
+}
+
+bool RadialDistortionStage::isPointwise() const
+{
+	return true;
+}
+
+void RadialDistortionStage::processRange(PointBuffer &buffer, int begin, int end)
+{
+	auto x = buffer.x;
+	auto y = buffer.y;
+
+	int i = begin;
+#if defined(SIMD_SSE2)
+	auto k1s = _mm_set1_ps(k1);
+	auto k2s = _mm_set1_ps(k2);
+	auto ones = _mm_set1_ps(1.f);
+	for (; i + 4 <= end; i += 4)
+	{
+		auto px = _mm_loadu_ps(x + i);
+		auto py = _mm_loadu_ps(y + i);
+		auto r2 = _mm_add_ps(_mm_mul_ps(px, px), _mm_mul_ps(py, py));
+		auto factor = _mm_add_ps(ones, _mm_mul_ps(r2, _mm_add_ps(k1s, _mm_mul_ps(k2s, r2))));
+		_mm_storeu_ps(x + i, _mm_mul_ps(px, factor));
+		_mm_storeu_ps(y + i, _mm_mul_ps(py, factor));
+	}
+#endif
+	for (; i < end; ++i)
+	{
+		auto r2 = x[i] * x[i] + y[i] * y[i];
+		auto factor = 1.f + r2 * (k1 + k2 * r2);
+		x[i] *= factor;
+		y[i] *= factor;
+	}
+}
+
+bool WarpGridStage::load(const std::string &path)
+{
+	std::ifstream file{ path };
+	if (!file)
+	{
+		std::cerr << "Unable to open warp grid file: " << path << std::endl;
+		return false;
+	}
+
+	if (!(file >> columnCount >> rowCount) || columnCount < 2 || rowCount < 2)
+	{
+		std::cerr << "Invalid warp grid size: " << path << std::endl;
+		return false;
+	}
+
+	std::vector<float> nodes(columnCount * rowCount * 2);
+	for (auto &value : nodes)
+	{
+		if (!(file >> value))
+		{
+			std::cerr << "Missing warp grid nodes: " << path << std::endl;
+			return false;
+		}
+	}
+
+	// Precomputes the bilinear form of each cell, so that lookups only need one cell.
+	auto cellCount = (columnCount - 1) * (rowCount - 1);
+	coefficients.resize(cellCount * 8);
+	for (int row = 0; row < rowCount - 1; ++row)
+	{
+		for (int column = 0; column < columnCount - 1; ++column)
+		{
+			auto cell = coefficients.data() + (row * (columnCount - 1) + column) * 8;
+			for (int axis = 0; axis < 2; ++axis)
+			{
+				auto v00 = nodes[(row * columnCount + column) * 2 + axis];
+				auto v10 = nodes[(row * columnCount + column + 1) * 2 + axis];
+				auto v01 = nodes[((row + 1) * columnCount + column) * 2 + axis];
+				auto v11 = nodes[((row + 1) * columnCount + column + 1) * 2 + axis];
+				cell[axis * 4 + 0] = v00;
+				cell[axis * 4 + 1] = v10 - v00;
+				cell[axis * 4 + 2] = v01 - v00;
+				cell[axis * 4 + 3] = v11 - v10 - v01 + v00;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool WarpGridStage::isPointwise() const
+{
+	return true;
+}
+
+void WarpGridStage::processRange(PointBuffer &buffer, int begin, int end)
+{
+	auto x = buffer.x;
+	auto y = buffer.y;
+	auto columnScale = .5f * (columnCount - 1);
+	auto rowScale = .5f * (rowCount - 1);
+	auto maxColumn = (float)(columnCount - 2);
+	auto maxRow = (float)(rowCount - 2);
+
+	// Cells are gathered per point, which SSE2 cannot vectorize; the loop has no other dependency.
+	for (int i = begin; i < end; ++i)
+	{
+		auto gx = (x[i] + 1.f) * columnScale;
+		auto gy = (y[i] + 1.f) * rowScale;
+
+		// Non-finite positions have no cell, and are passed through unchanged.
+		if (!std::isfinite(gx) || !std::isfinite(gy))
+		{
+			continue;
+		}
+
+		auto column = std::min(std::max(std::floor(gx), 0.f), maxColumn);
+		auto row = std::min(std::max(std::floor(gy), 0.f), maxRow);
+		auto u = gx - column;
+		auto v = gy - row;
+
+		auto cell = coefficients.data() + ((int)row * (columnCount - 1) + (int)column) * 8;
+		auto uv = u * v;
+		x[i] = cell[0] + cell[1] * u + cell[2] * v + cell[3] * uv;
+		y[i] = cell[4] + cell[5] * u + cell[6] * v + cell[7] * uv;
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "PointStage.hpp"
+
+// Projective transformation of positions, e.g. for keystone correction:
+// x' = (m[0] x + m[1] y + m[2]) / w, y' = (m[3] x + m[4] y + m[5]) / w, w = m[6] x + m[7] y + m[8].
+// Points where w is not positive, on or behind the horizon line, are blanked.
+class HomographyStage : public PointStage
+{
+public:
+	// Tilts the projection plane, x and y being the perspective factors along each axis.
+	static HomographyStage keystone(float x, float y);
+
+	HomographyStage(const float matrix[9]);
+
+	bool isPointwise() const override;
+	bool fuse(const PointStage &next) override;
+	void processRange(PointBuffer &buffer, int begin, int end) override;
+
+private:
+	float matrix[9];
+};
+
+// Radial distortion around the origin: p' = p (1 + k1 r^2 + k2 r^4). Positive coefficients correct barrel
+// distortion, negative ones pincushion distortion.
+class RadialDistortionStage : public PointStage
+{
+public:
+	RadialDistortionStage(float k1, float k2);
+
+	bool isPointwise() const override;
+	void processRange(PointBuffer &buffer, int begin, int end) override;
+
+private:
+	float k1, k2;
+};
+
+// Moves positions according to a calibration grid covering (-1, 1)^2, interpolating bilinearly between nodes.
+//
+// The grid file starts with the column and row counts, followed by the target position of each node, row by row
+// from the bottom left corner. Positions outside the grid use the nearest cell, non-finite ones are unchanged.
+class WarpGridStage : public PointStage
+{
+public:
+	// Returns false if the file is invalid.
+	bool load(const std::string &path);
+
+	bool isPointwise() const override;
+	void processRange(PointBuffer &buffer, int begin, int end) override;
+
+private:
+	int columnCount{ 0 };
+	int rowCount{ 0 };
+
+	// Per cell, bilinear coefficients of x and y: v = c0 + c1 u + c2 v + c3 u v, u and v being cell coordinates.
+	std::vector<float> coefficients;
+};
@@ -0,0 +1,133 @@
+#include "NullOutput.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "PointBuffer.hpp"
+#include "system.hpp"
+
+// Adds up the bits of the values, which compilers vectorize, unlike the byte-wise PointBuffer::hash().
+static uint32_t sumChannel(const float *channel, int count)
+{
+	uint32_t sum = 0;
+	for (int index = 0; index < count; ++index)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &channel[index], sizeof(bits));
+		sum += bits;
+	}
+	return sum;
+}
+
+NullOutput::NullOutput(const CommonParameters &commonParameters, cli::Parser &parser)
+	: Output{ commonParameters }
+{
+	consumptionRate = parser.option("consumption-rate")
+		.alias("cr")
+		.description("If greater than 0, consumes points at this rate per DAC instead of immediately.")
+		.defaultValue("0")
+		.getValueAs<int>();
+}
+
+InitializationStatus NullOutput::initialize()
+{
+	if (consumptionRate < 0)
+	{
+		std::cerr << "Consumption rate must not be negative." << std::endl;
+		return InitializationStatus::Failure;
+	}
+
+	intervalHistogram.assign(IntervalBucketCount + 1, 0);
+	return InitializationStatus::Success;
+}
+
+void NullOutput::shutdown()
+{
+	if (!reported && batchCount > 0)
+	{
+		printReport(std::cout);
+	}
+	reported = true;
+}
+
+bool NullOutput::needPoints()
+{
+	return consumptionRate == 0 || isNextBatchDue();
+}
+
+bool NullOutput::streamPoints(const PointBuffer *buffers)
+{
+	auto time = systemGetTimeNanoseconds();
+
+	uint64_t batchPointCount = 0;
+	for (int dacIndex = 0; dacIndex < commonParameters.dacCount; ++dacIndex)
+	{
+		auto &buffer = buffers[dacIndex];
+		const float *channels[] = { buffer.x, buffer.y, buffer.r, buffer.g, buffer.b };
+		for (auto channel : channels)
+		{
+			checksum = checksum * 31 + sumChannel(channel, buffer.count);
+		}
+		batchPointCount += buffer.count;
+	}
+
+	if (firstBatchTime < 0)
+	{
+		firstBatchTime = time;
+		firstBatchPointCount = batchPointCount;
+	}
+	else
+	{
+		auto interval = time - previousBatchTime;
+		auto bucket = std::min<int64_t>(interval / IntervalBucketWidth, IntervalBucketCount);
+		++intervalHistogram[(std::size_t)bucket];
+		maxInterval = std::max(maxInterval, interval);
+		++intervalCount;
+	}
+
+	previousBatchTime = time;
+	pointCount += batchPointCount;
+	++batchCount;
+
+	if (consumptionRate > 0)
+	{
+		scheduleNextBatch(buffers[0].count, consumptionRate);
+	}
+
+	return true;
+}
+
+void NullOutput::printReport(std::ostream &stream) const
+{
+	stream << "Null output: " << pointCount << " points in " << batchCount << " batches, checksum " << std::hex << checksum << std::dec << "." << std::endl;
+
+	if (intervalCount == 0)
+	{
+		return;
+	}
+
+	// The first batch only starts the clock, its points are not counted in the rate.
+	auto elapsed = previousBatchTime - firstBatchTime;
+	auto pointsPerSecond = (double)(pointCount - firstBatchPointCount) * 1e9 / std::max(elapsed, (int64_t)1);
+	stream << "Sustained rate: " << (uint64_t)pointsPerSecond << " points per second, " << (uint64_t)(pointsPerSecond / commonParameters.dacCount) << " per DAC." << std::endl;
+
+	// Upper bounds of the buckets holding the median and the 99th percentile, or the maximum if lower.
+	auto getPercentile = [&](uint64_t percent)
+	{
+		auto percentileCount = (intervalCount * percent + 99) / 100;
+		uint64_t cumulatedCount = 0;
+		int bucket = 0;
+		for (; bucket < IntervalBucketCount; ++bucket)
+		{
+			cumulatedCount += intervalHistogram[bucket];
+			if (cumulatedCount >= percentileCount)
+			{
+				break;
+			}
+		}
+		return std::min((bucket + 1) * IntervalBucketWidth, maxInterval) / 1000;
+	};
+
+	stream << "Batch interval: median up to " << getPercentile(50) << " us, 99% up to " << getPercentile(99) << " us, max " << maxInterval / 1000 << " us." << std::endl;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cli.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "Output.hpp"
+
+// Discards points, only reading them into a checksum so that nothing upstream is optimized away, and measures the
+// rate at which batches arrive. Being the cheapest output, it is the baseline to profile the generation path.
+//
+// Batches are consumed immediately, or at a simulated rate, like a device would.
+class NullOutput : public Output
+{
+public:
+	// Batch interval histogram bucket width and count, in nanoseconds.
+	static const int64_t IntervalBucketWidth = 10000;
+	static const int IntervalBucketCount = 10000;
+
+	NullOutput(const CommonParameters &commonParameters, cli::Parser &parser);
+
+	InitializationStatus initialize() override;
+
+	// Shows the report, once.
+	void shutdown() override;
+
+	bool needPoints() override;
+	bool streamPoints(const PointBuffer *buffers) override;
+
+	void printReport(std::ostream &stream) const;
+
+private:
+	int consumptionRate; // Points per second per DAC, 0 if immediate.
+	bool reported{ false };
+
+	uint64_t checksum{ 0 };
+	uint64_t batchCount{ 0 };
+	uint64_t pointCount{ 0 }; // All DACs.
+	uint64_t firstBatchPointCount{ 0 };
+	int64_t firstBatchTime{ -1 };
+	int64_t previousBatchTime{ -1 };
+
+	std::vector<uint64_t> intervalHistogram;
+	int64_t maxInterval{ 0 };
+	uint64_t intervalCount{ 0 };
+};
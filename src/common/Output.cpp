@@ -1,5 +1,9 @@
 #include "Output.hpp"
 
+#include <algorithm>
+
+#include "system.hpp"
+
 std::ostream &operator<<(std::ostream &stream, const Point &point)
 {
 	return stream << "Point: x=" << point.x << ", y=" << point.y << ", r=" << point.r << ", g=" << point.g << ", b=" << point.b;
@@ -17,3 +21,42 @@ Output::~Output()
 void Output::shutdown()
 {
 }
+
+bool Output::canRepeatPoints() const
+{
+	return false;
+}
+
+bool Output::streamRepeatedPoints(const PointBuffer *buffers)
+{
+	return streamPoints(buffers);
+}
+
+void Output::waitForPoints()
+{
+	if (systemGetTimeNanoseconds() < nextBatchTime)
+	{
+		systemWaitUntil(nextBatchTime);
+	}
+	else
+	{
+		systemPause();
+	}
+}
+
+bool Output::isNextBatchDue() const
+{
+	return systemGetTimeNanoseconds() >= nextBatchTime;
+}
+
+void Output::scheduleNextBatch(int pointCount)
+{
+	scheduleNextBatch(pointCount, commonParameters.pointsPerSecond);
+}
+
+void Output::scheduleNextBatch(int pointCount, int pointsPerSecond)
+{
+	// Integer nanoseconds, so that batches do not drift over long runs.
+	auto batchDuration = (int64_t)pointCount * 1000000000 / pointsPerSecond;
+	nextBatchTime = std::max(nextBatchTime, systemGetTimeNanoseconds()) + batchDuration;
+}
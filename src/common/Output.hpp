@@ -1,13 +1,22 @@
 #pragma once
 
+#include <cstdint>
 #include <ostream>
+#include <string>
+
+class BatchArena;
 
 struct CommonParameters
 {
-	int pointCount;
+	int dacCount;
+	int pointCount; // Per DAC, rendered.
+	int maxPointCount; // Per DAC, after the pipeline.
 	uint16_t pointsPerSecond;
 	std::string shaderPath;
+	bool offline;
+	float duration;
 	bool verbose;
+	BatchArena *arena; // Per-batch buffers are allocated from it.
 };
 
 enum class InitializationStatus
@@ -25,6 +34,8 @@ struct Point
 
 std::ostream &operator<<(std::ostream &stream, const Point &point);
 
+class PointBuffer;
+
 class Output
 {
 public:
@@ -35,8 +46,28 @@ public:
 	virtual void shutdown();
 
 	virtual bool needPoints() = 0;
-	virtual bool streamPoints(const Point *data) = 0;
+
+	// Waits until needPoints() is likely to return true: until the next batch is due for paced outputs, otherwise
+	// only yields.
+	void waitForPoints();
+
+	// buffers holds dacCount buffers, one per DAC, of the same count of at most maxPointCount points.
+	virtual bool streamPoints(const PointBuffer *buffers) = 0;
+
+	// Whether the device can repeat a batch by itself until the next one, so that static content is only sent once.
+	virtual bool canRepeatPoints() const;
+
+	// Streams a batch to be repeated until the next one. Only called if canRepeatPoints().
+	virtual bool streamRepeatedPoints(const PointBuffer *buffers);
 
 protected:
 	const CommonParameters &commonParameters;
+
+	// Paces outputs which are not throttled by a device at the laser rate.
+	bool isNextBatchDue() const;
+	void scheduleNextBatch(int pointCount);
+	void scheduleNextBatch(int pointCount, int pointsPerSecond); // At another rate than the laser.
+
+private:
+	int64_t nextBatchTime{ 0 }; // In nanoseconds.
 };
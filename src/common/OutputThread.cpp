@@ -0,0 +1,334 @@
+#include "OutputThread.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include "allocation.hpp"
+#include "metrics.hpp"
+#include "system.hpp"
+
+// Touched at startup, so that the thread does not page-fault on its stack later.
+static const int PrefaultedStackSize = 256 * 1024;
+
+static void prefaultStack()
+{
+	volatile char stack[PrefaultedStackSize];
+	for (int index = 0; index < PrefaultedStackSize; index += 4096)
+	{
+		stack[index] = 0;
+	}
+	(void)stack;
+}
+
+void applyThreadSettings(const ThreadSettings &settings, const char *threadName)
+{
+	if (settings.cpu >= 0 && !systemSetThreadAffinity(settings.cpu))
+	{
+		std::cerr << "Unable to pin the " << threadName << " thread to CPU " << settings.cpu << ", continuing unpinned." << std::endl;
+	}
+
+	if (settings.priority > 0 && !systemSetThreadRealTimePriority(settings.priority, settings.roundRobin))
+	{
+		std::cerr << "Unable to set the " << threadName << " thread priority, continuing with the default scheduling." << std::endl;
+	}
+
+	if (settings.lockMemory)
+	{
+		prefaultStack();
+	}
+}
+
+static void copyBuffer(const PointBuffer &source, PointBuffer &destination)
+{
+	std::copy(source.x, source.x + source.count, destination.x);
+	std::copy(source.y, source.y + source.count, destination.y);
+	std::copy(source.r, source.r + source.count, destination.r);
+	std::copy(source.g, source.g + source.count, destination.g);
+	std::copy(source.b, source.b + source.count, destination.b);
+	destination.count = source.count;
+}
+
+OutputThread::OutputThread(const CommonParameters &commonParameters, Output &output)
+	: commonParameters(commonParameters)
+	, output(output)
+	, jitterHistogram(JitterBucketCount + 1, 0)
+{
+	for (auto &slot : slots)
+	{
+		for (int dacIndex = 0; dacIndex < commonParameters.dacCount; ++dacIndex)
+		{
+			slot.buffers.emplace_back(commonParameters.maxPointCount, *commonParameters.arena);
+		}
+	}
+}
+
+OutputThread::~OutputThread()
+{
+	stop();
+}
+
+void OutputThread::enableWatchdog(float timeout, const std::vector<PointBuffer> &buffers)
+{
+	watchdogTimeout = std::max((int64_t)(timeout * 1e9), (int64_t)1);
+
+	fallbackBuffers.clear();
+	for (auto &buffer : buffers)
+	{
+		fallbackBuffers.emplace_back(buffer.count, *commonParameters.arena);
+		copyBuffer(buffer, fallbackBuffers.back());
+	}
+}
+
+void OutputThread::checkAllocations(int warmupCount)
+{
+	allocationWarmupCount = warmupCount;
+}
+
+bool OutputThread::hasAllocated() const
+{
+	return allocated;
+}
+
+uint64_t OutputThread::getStallCount() const
+{
+	return stallCount;
+}
+
+void OutputThread::start(const ThreadSettings &settings)
+{
+	thread = std::thread{ &OutputThread::run, this, settings };
+}
+
+void OutputThread::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		stopping = true;
+	}
+	condition.notify_all();
+
+	if (thread.joinable())
+	{
+		thread.join();
+	}
+}
+
+bool OutputThread::push(const std::vector<PointBuffer> &buffers, bool repeat)
+{
+	std::unique_lock<std::mutex> lock{ mutex };
+	condition.wait(lock, [this]()
+	{
+		return filledCount < SlotCount || failed;
+	});
+
+	if (failed)
+	{
+		return false;
+	}
+
+	// The slot is not accessed by the thread until it is filled.
+	auto &slot = slots[(readIndex + filledCount) % SlotCount];
+	lock.unlock();
+
+	for (int dacIndex = 0; dacIndex < commonParameters.dacCount; ++dacIndex)
+	{
+		copyBuffer(buffers[dacIndex], slot.buffers[dacIndex]);
+	}
+	slot.repeat = repeat;
+
+	lock.lock();
+	++filledCount;
+	metricsSet(MetricsGauge::OutputFilledSlots, filledCount);
+	lock.unlock();
+	condition.notify_all();
+
+	return true;
+}
+
+void OutputThread::run(ThreadSettings settings)
+{
+	applyThreadSettings(settings, "output");
+
+	for (;;)
+	{
+		Slot *slot = nullptr;
+		{
+			std::unique_lock<std::mutex> lock{ mutex };
+			auto ready = [this]()
+			{
+				return filledCount > 0 || stopping;
+			};
+
+			// Nothing is due before the first batch, nor while the device repeats one.
+			if (watchdogTimeout > 0 && !commonParameters.offline && previousStreamTime >= 0 && !repeating)
+			{
+				// Once stalled, fallback batches are streamed back to back.
+				auto deadline = previousStreamTime + previousBatchDuration + (stalled ? 0 : watchdogTimeout);
+				auto remaining = std::max(deadline - systemGetTimeNanoseconds(), (int64_t)0);
+				condition.wait_for(lock, std::chrono::nanoseconds{ remaining }, ready);
+			}
+			else
+			{
+				condition.wait(lock, ready);
+			}
+
+			if (filledCount > 0)
+			{
+				slot = &slots[readIndex];
+			}
+			else if (stopping)
+			{
+				return;
+			}
+		}
+
+		auto allocationCount = allocationGetThreadCount();
+
+		if (!slot)
+		{
+			if (!streamFallback())
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+				failed = true;
+				condition.notify_all();
+				return;
+			}
+
+			checkAllocationsSince(allocationCount);
+			continue;
+		}
+
+		if (stalled)
+		{
+			stalled = false;
+			std::cerr << "Rendering recovered." << std::endl;
+		}
+
+		// In offline mode, batches are streamed as fast as possible.
+		while (!commonParameters.offline && !output.needPoints())
+		{
+			output.waitForPoints();
+		}
+
+		auto streamStartTime = systemGetTimeNanoseconds();
+		auto streamed = slot->repeat ? output.streamRepeatedPoints(slot->buffers.data()) : output.streamPoints(slot->buffers.data());
+		recordStream(slot->buffers.data(), streamStartTime);
+		repeating = slot->repeat && output.canRepeatPoints();
+		checkAllocationsSince(allocationCount);
+
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			readIndex = (readIndex + 1) % SlotCount;
+			--filledCount;
+			metricsSet(MetricsGauge::OutputFilledSlots, filledCount);
+			failed = !streamed;
+		}
+		condition.notify_all();
+
+		if (!streamed)
+		{
+			return;
+		}
+	}
+}
+
+void OutputThread::checkAllocationsSince(uint64_t allocationCount)
+{
+	if (allocationWarmupCount > 0)
+	{
+		--allocationWarmupCount;
+	}
+	else if (allocationWarmupCount == 0 && allocationGetThreadCount() != allocationCount)
+	{
+		allocated = true;
+	}
+}
+
+bool OutputThread::streamFallback()
+{
+	if (!stalled)
+	{
+		stalled = true;
+		++stallCount;
+		std::cerr << "Rendering stalled, streaming the fallback batch." << std::endl;
+	}
+
+	while (!output.needPoints())
+	{
+		output.waitForPoints();
+	}
+
+	// Devices which repeat batches by themselves only need it once.
+	auto repeat = output.canRepeatPoints();
+	auto streamStartTime = systemGetTimeNanoseconds();
+	auto streamed = repeat ? output.streamRepeatedPoints(fallbackBuffers.data()) : output.streamPoints(fallbackBuffers.data());
+	recordStream(fallbackBuffers.data(), streamStartTime);
+	repeating = repeat;
+	++fallbackCount;
+	metricsIncrement(MetricsCounter::FallbackBatches);
+
+	return streamed;
+}
+
+void OutputThread::recordStream(const PointBuffer *buffers, int64_t startTime)
+{
+	auto time = systemGetTimeNanoseconds();
+
+	int totalPointCount = 0;
+	for (int dacIndex = 0; dacIndex < commonParameters.dacCount; ++dacIndex)
+	{
+		totalPointCount += buffers[dacIndex].count;
+	}
+
+	metricsObserve(MetricsHistogram::StreamDuration, time - startTime);
+	metricsIncrement(MetricsCounter::StreamedBatches);
+	metricsIncrement(MetricsCounter::StreamedPoints, totalPointCount);
+
+	if (previousStreamTime >= 0)
+	{
+		// Unless the device repeats the previous batch by itself, it has likely run out of points.
+		if (!commonParameters.offline && !repeating && time - previousStreamTime > previousBatchDuration + UnderrunMargin)
+		{
+			metricsIncrement(MetricsCounter::Underruns);
+		}
+
+		auto jitter = std::abs((time - previousStreamTime) - previousBatchDuration);
+		auto bucket = std::min<int64_t>(jitter / JitterBucketWidth, JitterBucketCount);
+		++jitterHistogram[(std::size_t)bucket];
+		maxJitter = std::max(maxJitter, jitter);
+		++jitterCount;
+	}
+
+	previousStreamTime = time;
+	previousBatchDuration = (int64_t)buffers[0].count * 1000000000 / commonParameters.pointsPerSecond;
+}
+
+void OutputThread::printJitterReport(std::ostream &stream) const
+{
+	if (jitterCount == 0)
+	{
+		return;
+	}
+
+	// Upper bound of the bucket holding the 99th percentile.
+	auto percentileCount = jitterCount - jitterCount / 100;
+	uint64_t cumulatedCount = 0;
+	int bucket = 0;
+	for (; bucket < JitterBucketCount; ++bucket)
+	{
+		cumulatedCount += jitterHistogram[bucket];
+		if (cumulatedCount >= percentileCount)
+		{
+			break;
+		}
+	}
+
+	stream << "Output jitter over " << jitterCount << " batches: 99% under " << (bucket + 1) * JitterBucketWidth / 1000 << " us, max " << maxJitter / 1000 << " us." << std::endl;
+
+	if (fallbackCount > 0)
+	{
+		stream << "Fallback batches streamed during stalls: " << fallbackCount << "." << std::endl;
+	}
+}
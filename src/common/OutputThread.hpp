@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include "Output.hpp"
+#include "PointBuffer.hpp"
+
+struct ThreadSettings
+{
+	int cpu{ -1 }; // -1 for no pinning.
+	int priority{ 0 }; // 0 for the default scheduling.
+	bool roundRobin{ false };
+	bool lockMemory{ false }; // Prefaults the stack.
+};
+
+// Applies settings to the calling thread, warning about those which are not permitted.
+void applyThreadSettings(const ThreadSettings &settings, const char *threadName);
+
+// Streams batches to the output on a dedicated thread, so that rendering does not delay the device feed and the
+// feeding thread can get a real-time priority.
+//
+// Batches are copied into a small ring of slots: push() blocks while all of them are waiting to be streamed.
+//
+// With the watchdog, if rendering stalls, a fallback batch is streamed from memory instead, so that the device
+// keeps being fed and does not need to be restarted. Pushed batches are streamed again as soon as they arrive.
+class OutputThread
+{
+public:
+	static const int SlotCount = 2;
+
+	OutputThread(const CommonParameters &commonParameters, Output &output);
+	~OutputThread();
+
+	// Enables the watchdog: once the previous batch has played, if no batch is pushed within timeout seconds,
+	// fallbackBuffers are streamed until rendering recovers. Not used in offline mode. Call before start().
+	void enableWatchdog(float timeout, const std::vector<PointBuffer> &fallbackBuffers);
+
+	// Once warmupCount batches have been streamed, flags any heap allocation made while streaming, see
+	// hasAllocated(). Call before start().
+	void checkAllocations(int warmupCount);
+
+	void start(const ThreadSettings &settings);
+
+	// Waits for the queued batches to be streamed, then stops the thread.
+	void stop();
+
+	// Returns false if the output failed.
+	bool push(const std::vector<PointBuffer> &buffers, bool repeat);
+
+	bool hasAllocated() const;
+
+	// Number of stalls so far, during which the fallback has been streamed. When it changes, the batches pushed
+	// before do not continue into the next one.
+	uint64_t getStallCount() const;
+
+	// Deviation of the intervals between streamed batches from their durations.
+	void printJitterReport(std::ostream &stream) const;
+
+private:
+	struct Slot
+	{
+		std::vector<PointBuffer> buffers;
+		bool repeat;
+	};
+
+	// A batch streamed later than this after the previous one has played counts as an underrun, in nanoseconds.
+	static const int64_t UnderrunMargin = 1000000;
+
+	// Jitter histogram bucket width and count, in nanoseconds.
+	static const int64_t JitterBucketWidth = 10000;
+	static const int JitterBucketCount = 1000;
+
+	const CommonParameters &commonParameters;
+	Output &output;
+
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable condition;
+
+	Slot slots[SlotCount];
+	int readIndex{ 0 };
+	int filledCount{ 0 };
+	bool stopping{ false };
+	bool failed{ false };
+
+	int64_t watchdogTimeout{ 0 }; // In nanoseconds, 0 if disabled.
+	int allocationWarmupCount{ -1 }; // -1 if not checked.
+	std::atomic<bool> allocated{ false };
+	std::vector<PointBuffer> fallbackBuffers;
+	std::atomic<uint64_t> stallCount{ 0 };
+
+	// Only accessed by the thread, then by printJitterReport() once stopped.
+	bool repeating{ false }; // Whether the device repeats the last batch by itself.
+	bool stalled{ false };
+	uint64_t fallbackCount{ 0 };
+	int64_t previousStreamTime{ -1 };
+	int64_t previousBatchDuration{ 0 };
+	std::vector<uint64_t> jitterHistogram;
+	int64_t maxJitter{ 0 };
+	uint64_t jitterCount{ 0 };
+
+	void run(ThreadSettings settings);
+	bool streamFallback();
+	void checkAllocationsSince(uint64_t allocationCount);
+
+	// Updates the jitter and the metrics once buffers have been streamed, from startTime.
+	void recordStream(const PointBuffer *buffers, int64_t startTime);
+};
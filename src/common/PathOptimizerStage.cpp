@@ -0,0 +1,214 @@
+#include "PathOptimizerStage.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "simd.hpp"
+
+PathOptimizerStage::PathOptimizerStage(int pointsPerSecond, float acceleration, float jumpDistance, float maxExtraRatio, float blankingDelay)
+	: pointsPerSecond{ (float)pointsPerSecond }
+	, acceleration{ acceleration }
+	, jumpDistance{ jumpDistance }
+	, maxExtraRatio{ maxExtraRatio }
+	, blankingPointCount{ std::max(1, (int)std::ceil(blankingDelay * pointsPerSecond)) }
+	, maxVelocityChange{ acceleration / ((float)pointsPerSecond * pointsPerSecond) }
+{
+}
+
+bool PathOptimizerStage::isPointwise() const
+{
+	return false;
+}
+
+int PathOptimizerStage::getMaxOutputCount(int inputCount) const
+{
+	return inputCount + 1 + (int)std::ceil(inputCount * maxExtraRatio);
+}
+
+void PathOptimizerStage::detect(int count)
+{
+	auto x = sequence.x;
+	auto y = sequence.y;
+	auto jumpThreshold = jumpDistance * jumpDistance;
+	auto cornerThreshold = maxVelocityChange * maxVelocityChange;
+
+	// Jumps, on segments [i - 1, i].
+	int index = 1;
+#if defined(SIMD_SSE2)
+	auto jumpThresholds = _mm_set1_ps(jumpThreshold);
+	for (; index + 4 <= count; index += 4)
+	{
+		auto dx = _mm_sub_ps(_mm_loadu_ps(x + index), _mm_loadu_ps(x + index - 1));
+		auto dy = _mm_sub_ps(_mm_loadu_ps(y + index), _mm_loadu_ps(y + index - 1));
+		auto distances = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+		auto mask = _mm_movemask_ps(_mm_cmpgt_ps(distances, jumpThresholds));
+
+		flags[index + 0] = (mask >> 0) & Jump;
+		flags[index + 1] = (mask >> 1) & Jump;
+		flags[index + 2] = (mask >> 2) & Jump;
+		flags[index + 3] = (mask >> 3) & Jump;
+	}
+#endif
+	for (; index < count; ++index)
+	{
+		auto dx = x[index] - x[index - 1];
+		auto dy = y[index] - y[index - 1];
+		flags[index] = (dx * dx + dy * dy > jumpThreshold) ? Jump : None;
+	}
+
+	// Corners, on points i, from the second difference. Points next to a jump are handled by the jump.
+	index = 1;
+#if defined(SIMD_SSE2)
+	auto cornerThresholds = _mm_set1_ps(cornerThreshold);
+	auto twos = _mm_set1_ps(2.f);
+	for (; index + 4 < count; index += 4)
+	{
+		auto dx = _mm_add_ps(_mm_sub_ps(_mm_loadu_ps(x + index + 1), _mm_mul_ps(twos, _mm_loadu_ps(x + index))), _mm_loadu_ps(x + index - 1));
+		auto dy = _mm_add_ps(_mm_sub_ps(_mm_loadu_ps(y + index + 1), _mm_mul_ps(twos, _mm_loadu_ps(y + index))), _mm_loadu_ps(y + index - 1));
+		auto changes = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+		auto mask = _mm_movemask_ps(_mm_cmpgt_ps(changes, cornerThresholds));
+
+		for (int lane = 0; lane < 4; ++lane)
+		{
+			auto lanePoint = index + lane;
+			if (((mask >> lane) & 1) && !(flags[lanePoint] & Jump) && !(flags[lanePoint + 1] & Jump))
+			{
+				flags[lanePoint] |= Corner;
+			}
+		}
+	}
+#endif
+	for (; index + 1 < count; ++index)
+	{
+		auto dx = x[index + 1] - 2.f * x[index] + x[index - 1];
+		auto dy = y[index + 1] - 2.f * y[index] + y[index - 1];
+		if (dx * dx + dy * dy > cornerThreshold && !(flags[index] & Jump) && !(flags[index + 1] & Jump))
+		{
+			flags[index] |= Corner;
+		}
+	}
+}
+
+int PathOptimizerStage::emitJump(PointBuffer &output, const Point &from, const Point &to, int budget)
+{
+	// Bang-bang travel from rest to rest: t = 2 * sqrt(d / a).
+	auto dx = to.x - from.x;
+	auto dy = to.y - from.y;
+	auto distance = std::sqrt(dx * dx + dy * dy);
+	auto travelPointCount = (int)std::ceil(2.f * std::sqrt(distance / acceleration) * pointsPerSecond);
+
+	auto insertedCount = 2 * blankingPointCount + travelPointCount;
+	if (insertedCount > budget)
+	{
+		return 0;
+	}
+
+	for (int index = 0; index < blankingPointCount; ++index)
+	{
+		output.set(output.count++, Point{ from.x, from.y, 0.f, 0.f, 0.f });
+	}
+
+	for (int index = 1; index <= travelPointCount; ++index)
+	{
+		auto t = (float)index / (travelPointCount + 1);
+		auto f = t < .5f ? 2.f * t * t : 1.f - 2.f * (1.f - t) * (1.f - t);
+		output.set(output.count++, Point{ from.x + dx * f, from.y + dy * f, 0.f, 0.f, 0.f });
+	}
+
+	for (int index = 0; index < blankingPointCount; ++index)
+	{
+		output.set(output.count++, Point{ to.x, to.y, 0.f, 0.f, 0.f });
+	}
+
+	return insertedCount;
+}
+
+int PathOptimizerStage::emitCorner(PointBuffer &output, int index, int budget)
+{
+	auto dx = sequence.x[index + 1] - 2.f * sequence.x[index] + sequence.x[index - 1];
+	auto dy = sequence.y[index + 1] - 2.f * sequence.y[index] + sequence.y[index - 1];
+	auto change = std::sqrt(dx * dx + dy * dy);
+
+	// The point itself already lasts one point.
+	auto insertedCount = std::min(budget, (int)std::ceil(change / maxVelocityChange) - 1);
+
+	auto point = sequence.get(index);
+	for (int dwellIndex = 0; dwellIndex < insertedCount; ++dwellIndex)
+	{
+		output.set(output.count++, point);
+	}
+
+	return std::max(0, insertedCount);
+}
+
+void PathOptimizerStage::allocate(int maxInputCount, BatchArena &arena)
+{
+	auto count = 2 + maxInputCount;
+	if (sequence.getCapacity() < count)
+	{
+		sequence = PointBuffer{ count, arena };
+		flags.resize(count);
+	}
+}
+
+void PathOptimizerStage::process(const PointBuffer &input, PointBuffer &output)
+{
+	output.count = 0;
+
+	auto count = 1 + (hasHeldPoint ? 1 : 0) + input.count;
+	if (sequence.getCapacity() < count)
+	{
+		sequence = PointBuffer{ count };
+		flags.resize(count);
+	}
+
+	sequence.set(0, lastEmittedPoint);
+	auto offset = 1;
+	if (hasHeldPoint)
+	{
+		sequence.set(offset++, heldPoint);
+	}
+	std::copy(input.x, input.x + input.count, sequence.x + offset);
+	std::copy(input.y, input.y + input.count, sequence.y + offset);
+	std::copy(input.r, input.r + input.count, sequence.r + offset);
+	std::copy(input.g, input.g + input.count, sequence.g + offset);
+	std::copy(input.b, input.b + input.count, sequence.b + offset);
+
+	if (count < 2)
+	{
+		return;
+	}
+
+	detect(count);
+
+	auto budget = (int)std::ceil(input.count * maxExtraRatio);
+
+	// The last point is held, since its corner depends on the next batch.
+	for (int index = 1; index + 1 < count; ++index)
+	{
+		if (flags[index] & Jump)
+		{
+			budget -= emitJump(output, sequence.get(index - 1), sequence.get(index), budget);
+		}
+
+		output.set(output.count++, sequence.get(index));
+
+		if (flags[index] & Corner)
+		{
+			budget -= emitCorner(output, index, budget);
+		}
+	}
+
+	if (output.count > 0)
+	{
+		lastEmittedPoint = output.get(output.count - 1);
+	}
+	heldPoint = sequence.get(count - 1);
+	hasHeldPoint = true;
+}
+
+void PathOptimizerStage::reset()
+{
+	lastEmittedPoint = Point{ 0.f, 0.f, 0.f, 0.f, 0.f };
+	hasHeldPoint = false;
+}
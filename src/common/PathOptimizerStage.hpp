@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+
+#include "PointStage.hpp"
+
+// Inserts points so that the scanners can follow the path, given their acceleration limit.
+//
+// - Jumps, i.e. segments longer than jumpDistance, are replaced by blanked travel points, with blanked dwell
+//   points at both ends to let the laser switch.
+// - Corners, where the velocity change needs more than one point at the acceleration limit, get dwell points.
+//
+// The last point of each batch is held until the next one, since corners depend on the following point.
+// Insertions per batch are limited to maxExtraRatio times the input count.
+class PathOptimizerStage : public PointStage
+{
+public:
+	PathOptimizerStage(int pointsPerSecond, float acceleration, float jumpDistance, float maxExtraRatio, float blankingDelay);
+
+	bool isPointwise() const override;
+	int getMaxOutputCount(int inputCount) const override;
+	void allocate(int maxInputCount, BatchArena &arena) override;
+	void process(const PointBuffer &input, PointBuffer &output) override;
+	void reset() override;
+
+private:
+	enum Flags : uint8_t
+	{
+		None = 0,
+		Jump = 1 << 0, // Segment from the previous point.
+		Corner = 1 << 1,
+	};
+
+	float pointsPerSecond;
+	float acceleration;
+	float jumpDistance;
+	float maxExtraRatio;
+	int blankingPointCount;
+
+	// Distance increment corresponding to the acceleration limit during one point.
+	float maxVelocityChange;
+
+	Point lastEmittedPoint{ 0.f, 0.f, 0.f, 0.f, 0.f };
+	Point heldPoint;
+	bool hasHeldPoint{ false };
+
+	// Lasts emitted point, held point, then input points.
+	PointBuffer sequence;
+	std::vector<uint8_t> flags;
+
+	void detect(int count);
+	int emitJump(PointBuffer &output, const Point &from, const Point &to, int budget);
+	int emitCorner(PointBuffer &output, int index, int budget);
+};
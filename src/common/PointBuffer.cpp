@@ -0,0 +1,99 @@
+#include "PointBuffer.hpp"
+
+#include <cstdint>
+#include <new>
+
+#include "BatchArena.hpp"
+
+static int getStride(int capacity)
+{
+	const int floatsPerAlignment = PointBuffer::Alignment / sizeof(float);
+	return (capacity + floatsPerAlignment - 1) / floatsPerAlignment * floatsPerAlignment;
+}
+
+PointBuffer::PointBuffer()
+{
+}
+
+PointBuffer::PointBuffer(int capacity)
+	: capacity{ capacity }
+{
+	const int floatsPerAlignment = Alignment / sizeof(float);
+	auto stride = getStride(capacity);
+
+	storage.reset(new float[stride * 5 + floatsPerAlignment]());
+
+	auto address = (uintptr_t)storage.get();
+	setChannels((float *)((address + Alignment - 1) & ~(uintptr_t)(Alignment - 1)), stride);
+}
+
+PointBuffer::PointBuffer(int capacity, BatchArena &arena)
+	: capacity{ capacity }
+{
+	static_assert(BatchArena::Alignment % Alignment == 0, "Arena allocations must be aligned for buffers.");
+
+	auto stride = getStride(capacity);
+	auto aligned = arena.allocate<float>((std::size_t)stride * 5);
+	if (!aligned)
+	{
+		throw std::bad_alloc{};
+	}
+
+	setChannels(aligned, stride);
+}
+
+void PointBuffer::setChannels(float *aligned, int stride)
+{
+	x = aligned;
+	y = x + stride;
+	r = y + stride;
+	g = r + stride;
+	b = g + stride;
+}
+
+int PointBuffer::getCapacity() const
+{
+	return capacity;
+}
+
+Point PointBuffer::get(int index) const
+{
+	return Point{ x[index], y[index], r[index], g[index], b[index] };
+}
+
+void PointBuffer::set(int index, const Point &point)
+{
+	x[index] = point.x;
+	y[index] = point.y;
+	r[index] = point.r;
+	g[index] = point.g;
+	b[index] = point.b;
+}
+
+void PointBuffer::unpack(const float *pointsXY, const float *pointsRGB, int count)
+{
+	for (int index = 0; index < count; ++index)
+	{
+		x[index] = pointsXY[index * 2 + 0];
+		y[index] = pointsXY[index * 2 + 1];
+		r[index] = pointsRGB[index * 3 + 0];
+		g[index] = pointsRGB[index * 3 + 1];
+		b[index] = pointsRGB[index * 3 + 2];
+	}
+	this->count = count;
+}
+
+uint64_t PointBuffer::hash() const
+{
+	uint64_t value = 14695981039346656037ull;
+	const float *channels[] = { x, y, r, g, b };
+	for (auto channel : channels)
+	{
+		auto bytes = (const uint8_t *)channel;
+		for (size_t index = 0; index < count * sizeof(float); ++index)
+		{
+			value = (value ^ bytes[index]) * 1099511628211ull;
+		}
+	}
+	return value;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "Output.hpp"
+
+// Points of a single DAC, stored as a structure of arrays so that channels can be processed with SIMD.
+class BatchArena;
+
+class PointBuffer
+{
+public:
+	// Channels are aligned on this many bytes.
+	static const int Alignment = 64;
+
+	PointBuffer();
+	PointBuffer(int capacity);
+
+	// Takes the memory from the arena, which must outlive the buffer.
+	PointBuffer(int capacity, BatchArena &arena);
+
+	int getCapacity() const;
+
+	Point get(int index) const;
+	void set(int index, const Point &point);
+
+	// Copies count points from the interleaved readback of the position and color textures.
+	void unpack(const float *pointsXY, const float *pointsRGB, int count);
+
+	// FNV-1a hash of the points, to detect changes.
+	uint64_t hash() const;
+
+	float *x{ nullptr };
+	float *y{ nullptr };
+	float *r{ nullptr };
+	float *g{ nullptr };
+	float *b{ nullptr };
+	int count{ 0 };
+
+private:
+	std::unique_ptr<float[]> storage; // Unless from an arena.
+	int capacity{ 0 };
+
+	void setChannels(float *aligned, int stride);
+};
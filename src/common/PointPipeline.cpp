@@ -0,0 +1,389 @@
+#include "PointPipeline.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+#include "ColorLutStage.hpp"
+#include "GeometryStages.hpp"
+#include "PathOptimizerStage.hpp"
+#include "PowerLimiterStage.hpp"
+#include "ResamplingStages.hpp"
+#include "SafetyZoneStage.hpp"
+#include "TransformStages.hpp"
+
+static const float DegreesToRadians = 3.14159265f / 180.f;
+
+static bool parseFloats(const std::vector<std::string> &arguments, std::vector<float> &values)
+{
+	for (auto &argument : arguments)
+	{
+		char *end;
+		auto value = std::strtof(argument.c_str(), &end);
+		if (end == argument.c_str() || *end != '\0')
+		{
+			return false;
+		}
+		values.push_back(value);
+	}
+	return true;
+}
+
+static std::unique_ptr<PointStage> createStage(const std::string &name, const std::vector<std::string> &arguments, const PointStageContext &context)
+{
+	std::vector<float> values;
+	auto numeric = parseFloats(arguments, values);
+
+	if (name == "offset" && numeric && values.size() == 2)
+	{
+		return std::unique_ptr<PointStage>{ new AffineStage{ AffineStage::offset(values[0], values[1]) } };
+	}
+
+	if (name == "scale" && numeric && (values.size() == 1 || values.size() == 2))
+	{
+		return std::unique_ptr<PointStage>{ new AffineStage{ AffineStage::scale(values[0], values.back()) } };
+	}
+
+	if (name == "rotate" && numeric && values.size() == 1)
+	{
+		return std::unique_ptr<PointStage>{ new AffineStage{ AffineStage::rotate(values[0] * DegreesToRadians) } };
+	}
+
+	if (name == "gain" && numeric && (values.size() == 1 || values.size() == 3))
+	{
+		return std::unique_ptr<PointStage>{ new ColorGainStage{ values[0], values[values.size() / 2], values.back() } };
+	}
+
+	if (name == "homography" && numeric && values.size() == 9)
+	{
+		return std::unique_ptr<PointStage>{ new HomographyStage{ values.data() } };
+	}
+
+	if (name == "keystone" && numeric && values.size() == 2)
+	{
+		return std::unique_ptr<PointStage>{ new HomographyStage{ HomographyStage::keystone(values[0], values[1]) } };
+	}
+
+	if (name == "radial" && numeric && (values.size() == 1 || values.size() == 2))
+	{
+		return std::unique_ptr<PointStage>{ new RadialDistortionStage{ values[0], values.size() > 1 ? values[1] : 0.f } };
+	}
+
+	if (name == "warp" && arguments.size() == 1)
+	{
+		auto warpStage = new WarpGridStage{};
+		std::unique_ptr<PointStage> stage{ warpStage };
+		if (!warpStage->load(arguments[0]))
+		{
+			return nullptr;
+		}
+		return stage;
+	}
+
+	if (name == "lut" && arguments.size() == 1)
+	{
+		auto lutStage = new ColorLutStage{ arguments[0], context.fileWatcher };
+		std::unique_ptr<PointStage> stage{ lutStage };
+		if (!lutStage->load())
+		{
+			return nullptr;
+		}
+		return stage;
+	}
+
+	if (name == "zones" && (arguments.size() == 1 || arguments.size() == 2))
+	{
+		std::vector<float> resolution{ 512.f };
+		if (arguments.size() == 2 && (!parseFloats({ arguments[1] }, resolution) || resolution.back() < 1.f))
+		{
+			return nullptr;
+		}
+
+		auto zoneStage = new SafetyZoneStage{ arguments[0], (int)resolution.back(), context.fileWatcher };
+		std::unique_ptr<PointStage> stage{ zoneStage };
+		if (!zoneStage->load())
+		{
+			return nullptr;
+		}
+		return stage;
+	}
+
+	if (name == "clamp" && arguments.empty())
+	{
+		return std::unique_ptr<PointStage>{ new ClampStage{} };
+	}
+
+	if (name == "path" && numeric && values.size() >= 2 && values.size() <= 4 && values[0] > 0.f && values[1] > 0.f)
+	{
+		auto maxExtraRatio = values.size() > 2 ? values[2] : 1.f;
+		auto blankingDelay = values.size() > 3 ? values[3] : 1e-4f;
+
+		// A negative ratio would undersize the buffers which the stage fills.
+		if (maxExtraRatio < 0.f || blankingDelay < 0.f)
+		{
+			return nullptr;
+		}
+		return std::unique_ptr<PointStage>{ new PathOptimizerStage{ context.pointsPerSecond, values[0], values[1], maxExtraRatio, blankingDelay } };
+	}
+
+	if (name == "power" && numeric && (values.size() == 2 || values.size() == 3) && values[0] > 0.f && values[1] > 0.f)
+	{
+		auto maxAveragePower = values.size() > 2 ? values[2] : 1.f;
+		return std::unique_ptr<PointStage>{ new PowerLimiterStage{ context.pointsPerSecond, values[0], values[1], maxAveragePower } };
+	}
+
+	if (name == "resample" && (arguments.size() == 1 || arguments.size() == 2))
+	{
+		std::vector<float> ratio;
+		if (!parseFloats({ arguments[0] }, ratio) || ratio[0] <= 0.f)
+		{
+			return nullptr;
+		}
+
+		auto interpolation = arguments.size() == 2 ? arguments[1] : "cubic";
+		if (interpolation == "linear")
+		{
+			return std::unique_ptr<PointStage>{ new ResamplingStage{ ratio[0], ResamplingStage::Interpolation::Linear } };
+		}
+		if (interpolation == "cubic")
+		{
+			return std::unique_ptr<PointStage>{ new ResamplingStage{ ratio[0], ResamplingStage::Interpolation::CatmullRom } };
+		}
+	}
+
+	if (name == "resample-arc" && numeric && values.size() >= 1 && values.size() <= 3 && values[0] > 0.f)
+	{
+		auto maxRatio = values.size() > 1 ? values[1] : 4.f;
+		auto minRatio = values.size() > 2 ? values[2] : std::min(.5f, maxRatio);
+		if (maxRatio <= 0.f || minRatio < 0.f || minRatio > maxRatio)
+		{
+			return nullptr;
+		}
+		return std::unique_ptr<PointStage>{ new ArcLengthResamplingStage{ values[0], minRatio, maxRatio } };
+	}
+
+	return nullptr;
+}
+
+bool PointPipeline::parse(const std::string &description, const PointStageContext &context)
+{
+	std::istringstream descriptionStream{ description };
+	std::string line;
+
+	auto inSection = true;
+
+	while (std::getline(descriptionStream, line))
+	{
+		line = line.substr(0, line.find('#'));
+
+		std::istringstream sectionStream{ line };
+		std::string section;
+		if (sectionStream >> section && section[0] == '[')
+		{
+			std::string rest;
+			std::getline(sectionStream, rest);
+			section += rest;
+			section.erase(std::remove(section.begin(), section.end(), ' '), section.end());
+
+			int sectionDacIndex;
+			char end;
+			if (section == "[all]")
+			{
+				inSection = true;
+			}
+			else if (std::sscanf(section.c_str(), "[dac%d%c", &sectionDacIndex, &end) == 2 && end == ']')
+			{
+				inSection = (sectionDacIndex == context.dacIndex);
+			}
+			else
+			{
+				std::cerr << "Invalid section: " << line << std::endl;
+				return false;
+			}
+			continue;
+		}
+
+		if (!inSection)
+		{
+			continue;
+		}
+
+		std::istringstream lineStream{ line };
+		std::string stageDescription;
+		while (std::getline(lineStream, stageDescription, ';'))
+		{
+			std::replace(stageDescription.begin(), stageDescription.end(), ',', ' ');
+
+			std::istringstream stageStream{ stageDescription };
+			std::string name;
+			if (!(stageStream >> name))
+			{
+				continue;
+			}
+
+			std::vector<std::string> arguments;
+			std::string argument;
+			while (stageStream >> argument)
+			{
+				arguments.push_back(argument);
+			}
+
+			auto stage = createStage(name, arguments, context);
+			if (!stage)
+			{
+				std::cerr << "Invalid stage: " << stageDescription << std::endl;
+				return false;
+			}
+
+			add(std::move(stage));
+		}
+	}
+
+	return true;
+}
+
+void PointPipeline::add(std::unique_ptr<PointStage> stage)
+{
+	if (!stages.empty() && stages.back()->fuse(*stage))
+	{
+		return;
+	}
+
+	stages.push_back(std::move(stage));
+}
+
+bool PointPipeline::isEmpty() const
+{
+	return stages.empty();
+}
+
+bool PointPipeline::isStateless() const
+{
+	return std::all_of(stages.begin(), stages.end(), [](const std::unique_ptr<PointStage> &stage)
+	{
+		return stage->isPointwise();
+	});
+}
+
+int PointPipeline::getMaxCapacity(int inputCount) const
+{
+	auto capacity = inputCount;
+	auto count = inputCount;
+	for (auto &stage : stages)
+	{
+		count = stage->getMaxOutputCount(count);
+		capacity = std::max(capacity, count);
+	}
+	return capacity;
+}
+
+int PointPipeline::getMaxOutputCount(int inputCount) const
+{
+	auto count = inputCount;
+	for (auto &stage : stages)
+	{
+		count = stage->getMaxOutputCount(count);
+	}
+	return count;
+}
+
+void PointPipeline::allocate(int inputCount, BatchArena &arena, int minCapacity)
+{
+	auto capacity = std::max(getMaxCapacity(inputCount), minCapacity);
+	if (scratchBuffer.getCapacity() < capacity)
+	{
+		scratchBuffer = PointBuffer{ capacity, arena };
+	}
+
+	auto count = inputCount;
+	for (auto &stage : stages)
+	{
+		stage->allocate(count, arena);
+		count = stage->getMaxOutputCount(count);
+	}
+}
+
+void PointPipeline::process(PointBuffer &buffer)
+{
+	for (auto &stage : stages)
+	{
+		stage->beginBatch();
+	}
+
+	std::size_t stageIndex = 0;
+	while (stageIndex < stages.size())
+	{
+		if (!stages[stageIndex]->isPointwise())
+		{
+			stages[stageIndex]->process(buffer, scratchBuffer);
+			std::swap(buffer, scratchBuffer);
+			++stageIndex;
+			continue;
+		}
+
+		// Fuses consecutive pointwise stages into a single pass over the buffer.
+		auto groupEnd = stageIndex;
+		while (groupEnd < stages.size() && stages[groupEnd]->isPointwise())
+		{
+			++groupEnd;
+		}
+
+		for (int begin = 0; begin < buffer.count; begin += BlockSize)
+		{
+			auto end = std::min(buffer.count, begin + BlockSize);
+			for (auto index = stageIndex; index < groupEnd; ++index)
+			{
+				stages[index]->processRange(buffer, begin, end);
+			}
+		}
+
+		stageIndex = groupEnd;
+	}
+}
+
+void PointPipeline::reset()
+{
+	for (auto &stage : stages)
+	{
+		stage->reset();
+	}
+}
+
+bool PointPipeline::hasPendingChange() const
+{
+	return std::any_of(stages.begin(), stages.end(), [](const std::unique_ptr<PointStage> &stage)
+	{
+		return stage->hasPendingChange();
+	});
+}
+
+int PointPipeline::getMaxCapacity(const std::vector<PointPipeline> &pipelines, int inputCount)
+{
+	auto capacity = inputCount;
+	for (auto &pipeline : pipelines)
+	{
+		capacity = std::max(capacity, pipeline.getMaxCapacity(inputCount));
+	}
+	return capacity;
+}
+
+void PointPipeline::equalizeCounts(std::vector<PointBuffer> &buffers)
+{
+	auto count = 0;
+	for (auto &buffer : buffers)
+	{
+		count = std::max(count, buffer.count);
+	}
+
+	for (auto &buffer : buffers)
+	{
+		auto point = buffer.count > 0 ? buffer.get(buffer.count - 1) : Point{ 0.f, 0.f, 0.f, 0.f, 0.f };
+		point.r = point.g = point.b = 0.f;
+		while (buffer.count < count)
+		{
+			buffer.set(buffer.count++, point);
+		}
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "PointBuffer.hpp"
+#include "PointStage.hpp"
+
+class FileWatcher;
+
+// Settings which stages may depend on.
+struct PointStageContext
+{
+	int pointsPerSecond;
+
+	// DAC of the pipeline being parsed.
+	int dacIndex;
+
+	// Lets stages reload their files when they change, may be null.
+	FileWatcher *fileWatcher;
+};
+
+// Chain of stages applied to the points of a single DAC, between the readback and the output.
+//
+// A description lists stages separated by new lines or semicolons, each being a name followed by arguments
+// separated by spaces or commas, e.g. "offset 0.1 0; rotate 90; gain 1 .8 .8". Text after # is ignored.
+//
+// A line "[dac n]" starts a section whose stages only apply to the DAC n, until a line "[all]".
+class PointPipeline
+{
+public:
+	// Number of points processed by consecutive pointwise stages before moving to the next block.
+	static const int BlockSize = 256;
+
+	// Returns false if the description is invalid.
+	bool parse(const std::string &description, const PointStageContext &context);
+
+	void add(std::unique_ptr<PointStage> stage);
+
+	bool isEmpty() const;
+
+	// Whether the same input always gives the same output, i.e. all stages are pointwise.
+	bool isStateless() const;
+
+	// Upper bound of the number of points in the buffers along the chain.
+	int getMaxCapacity(int inputCount) const;
+	int getMaxOutputCount(int inputCount) const;
+
+	// Allocates the intermediate buffer, of at least minCapacity points, and those of the stages.
+	void allocate(int inputCount, BatchArena &arena, int minCapacity = 0);
+
+	// Buffer capacity must be at least getMaxCapacity(buffer.count). The buffer may be swapped with the
+	// intermediate one.
+	void process(PointBuffer &buffer);
+
+	// Resets the stages, see PointStage::reset().
+	void reset();
+
+	// Whether a stage will change the output of the next batch, see PointStage::hasPendingChange().
+	bool hasPendingChange() const;
+
+	// Largest capacity needed by the pipelines, which buffers and intermediate buffers need for equalizeCounts().
+	static int getMaxCapacity(const std::vector<PointPipeline> &pipelines, int inputCount);
+
+	// Pads buffers with blanked copies of their last point up to the largest count, since pipelines may emit
+	// different counts per DAC, and all DACs of a batch must play for the same duration.
+	static void equalizeCounts(std::vector<PointBuffer> &buffers);
+
+private:
+	std::vector<std::unique_ptr<PointStage>> stages;
+	PointBuffer scratchBuffer;
+};
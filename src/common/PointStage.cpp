@@ -0,0 +1,41 @@
+#include "PointStage.hpp"
+
+PointStage::~PointStage()
+{
+}
+
+int PointStage::getMaxOutputCount(int inputCount) const
+{
+	return inputCount;
+}
+
+void PointStage::allocate(int, BatchArena &)
+{
+}
+
+bool PointStage::fuse(const PointStage &)
+{
+	return false;
+}
+
+void PointStage::beginBatch()
+{
+}
+
+bool PointStage::hasPendingChange() const
+{
+	return false;
+}
+
+void PointStage::processRange(PointBuffer &, int, int)
+{
+}
+
+void PointStage::process(const PointBuffer &input, PointBuffer &output)
+{
+	output.count = input.count;
+}
+
+void PointStage::reset()
+{
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "PointBuffer.hpp"
+
+class BatchArena;
+
+// A step of the point pipeline, applied between the readback and the output.
+class PointStage
+{
+public:
+	virtual ~PointStage();
+
+	// Whether points are transformed independently and in place. Consecutive pointwise stages are run block by
+	// block, so that points stay in cache between them.
+	virtual bool isPointwise() const = 0;
+
+	// Upper bound of the number of output points.
+	virtual int getMaxOutputCount(int inputCount) const;
+
+	// Allocates the buffers needed to process up to maxInputCount points, so that processing does not allocate.
+	virtual void allocate(int maxInputCount, BatchArena &arena);
+
+	// Merges the next stage into this one if possible, in which case the next stage is dropped.
+	virtual bool fuse(const PointStage &next);
+
+	// Called before each batch, e.g. to swap in files reloaded on another thread, so that a batch is processed
+	// with the same content throughout.
+	virtual void beginBatch();
+
+	// Whether the next beginBatch() will change the output, e.g. with a reloaded file.
+	virtual bool hasPendingChange() const;
+
+	// Pointwise stages: transforms points [begin, end) in place.
+	virtual void processRange(PointBuffer &buffer, int begin, int end);
+
+	// Other stages: output capacity is at least getMaxOutputCount(input.count).
+	virtual void process(const PointBuffer &input, PointBuffer &output);
+
+	// Stages which are not pointwise: forgets the previous points, e.g. when other points have been streamed in
+	// between, so that the next batch is processed as the first one.
+	virtual void reset();
+};
@@ -0,0 +1,287 @@
+#include "PointStreamCodec.hpp"
+
+#include <cmath>
+
+namespace PointStreamCodec
+{
+	static const int PacketCountOffset = 12;
+	static const int AbsolutePositionSize = 4;
+	static const int DeltaPositionSize = 2;
+
+	static void write16(uint8_t *&cursor, uint16_t value)
+	{
+		cursor[0] = (uint8_t)value;
+		cursor[1] = (uint8_t)(value >> 8);
+		cursor += 2;
+	}
+
+	static void write32(uint8_t *&cursor, uint32_t value)
+	{
+		write16(cursor, (uint16_t)value);
+		write16(cursor, (uint16_t)(value >> 16));
+	}
+
+	static uint16_t read16(const uint8_t *&cursor)
+	{
+		auto value = (uint16_t)(cursor[0] | (cursor[1] << 8));
+		cursor += 2;
+		return value;
+	}
+
+	static uint32_t read32(const uint8_t *&cursor)
+	{
+		uint32_t low = read16(cursor);
+		uint32_t high = read16(cursor);
+		return low | (high << 16);
+	}
+
+	static int quantize(float value, float scale, int min, int max)
+	{
+		auto quantized = (int)std::lround(value * scale);
+		return quantized < min ? min : (quantized > max ? max : quantized);
+	}
+
+	static int getColorSize(uint8_t flags)
+	{
+		return (flags & Color16) ? 6 : 3;
+	}
+
+	Encoder::Encoder(int packetSize, bool color16, bool deltaPositions)
+		: packetSize{ packetSize }
+		, flags{ (uint8_t)((color16 ? Color16 : 0) | (deltaPositions ? DeltaPositions : 0)) }
+	{
+	}
+
+	int Encoder::getMaxPacketCount(int pointCount) const
+	{
+		// Escaped delta points are the largest.
+		auto maxPointSize = 1 + AbsolutePositionSize + getColorSize(flags);
+		auto pointsPerPacket = (packetSize - HeaderSize - AbsolutePositionSize) / maxPointSize;
+		return (pointCount + pointsPerPacket - 1) / pointsPerPacket;
+	}
+
+	void Encoder::clear()
+	{
+		sizes.clear();
+	}
+
+	void Encoder::reserve(int packetCount)
+	{
+		data.resize((std::size_t)packetCount * packetSize);
+		sizes.reserve(packetCount);
+	}
+
+	void Encoder::encode(uint32_t batchSequence, uint16_t dacIndex, const PointBuffer &buffer)
+	{
+		auto pointCount = buffer.count;
+		auto colorSize = getColorSize(flags);
+		auto firstPacket = (int)sizes.size();
+
+		int pointIndex = 0;
+		while (pointIndex < pointCount)
+		{
+			auto packetIndex = (int)sizes.size();
+			if ((int)data.size() < (packetIndex + 1) * packetSize)
+			{
+				data.resize((std::size_t)(packetIndex + 1) * packetSize);
+			}
+
+			auto packet = &data[(std::size_t)packetIndex * packetSize];
+			auto end = packet + packetSize;
+			auto cursor = packet + HeaderSize;
+
+			auto firstPoint = pointIndex;
+			int previousX = 0;
+			int previousY = 0;
+
+			for (; pointIndex < pointCount; ++pointIndex)
+			{
+				auto x = quantize(buffer.x[pointIndex], 32767.f, -32768, 32767);
+				auto y = quantize(buffer.y[pointIndex], 32767.f, -32768, 32767);
+
+				auto dx = x - previousX;
+				auto dy = y - previousY;
+				auto delta = (flags & DeltaPositions) && pointIndex > firstPoint
+					&& dx > DeltaEscape && dx <= 127 && dy > DeltaEscape && dy <= 127;
+
+				int positionSize;
+				if (delta)
+				{
+					positionSize = DeltaPositionSize;
+				}
+				else
+				{
+					positionSize = (flags & DeltaPositions) && pointIndex > firstPoint ? 1 + AbsolutePositionSize : AbsolutePositionSize;
+				}
+
+				if (cursor + positionSize + colorSize > end)
+				{
+					break;
+				}
+
+				if (delta)
+				{
+					*cursor++ = (uint8_t)(int8_t)dx;
+					*cursor++ = (uint8_t)(int8_t)dy;
+				}
+				else
+				{
+					if (positionSize > AbsolutePositionSize)
+					{
+						*cursor++ = (uint8_t)DeltaEscape;
+					}
+					write16(cursor, (uint16_t)(int16_t)x);
+					write16(cursor, (uint16_t)(int16_t)y);
+				}
+
+				previousX = x;
+				previousY = y;
+
+				if (flags & Color16)
+				{
+					write16(cursor, (uint16_t)quantize(buffer.r[pointIndex], 65535.f, 0, 65535));
+					write16(cursor, (uint16_t)quantize(buffer.g[pointIndex], 65535.f, 0, 65535));
+					write16(cursor, (uint16_t)quantize(buffer.b[pointIndex], 65535.f, 0, 65535));
+				}
+				else
+				{
+					*cursor++ = (uint8_t)quantize(buffer.r[pointIndex], 255.f, 0, 255);
+					*cursor++ = (uint8_t)quantize(buffer.g[pointIndex], 255.f, 0, 255);
+					*cursor++ = (uint8_t)quantize(buffer.b[pointIndex], 255.f, 0, 255);
+				}
+			}
+
+			auto headerCursor = packet;
+			write16(headerCursor, Magic);
+			*headerCursor++ = Version;
+			*headerCursor++ = flags;
+			write32(headerCursor, batchSequence);
+			write16(headerCursor, dacIndex);
+			write16(headerCursor, (uint16_t)(packetIndex - firstPacket));
+			write16(headerCursor, 0); // Packet count, patched below.
+			write16(headerCursor, (uint16_t)pointCount);
+			write16(headerCursor, (uint16_t)firstPoint);
+			write16(headerCursor, (uint16_t)(pointIndex - firstPoint));
+
+			sizes.push_back((int)(cursor - packet));
+		}
+
+		auto packetCount = (uint16_t)(sizes.size() - firstPacket);
+		for (auto packetIndex = firstPacket; packetIndex < (int)sizes.size(); ++packetIndex)
+		{
+			auto cursor = &data[(std::size_t)packetIndex * packetSize + PacketCountOffset];
+			write16(cursor, packetCount);
+		}
+	}
+
+	int Encoder::getPacketCount() const
+	{
+		return (int)sizes.size();
+	}
+
+	const uint8_t *Encoder::getPacket(int index) const
+	{
+		return &data[(std::size_t)index * packetSize];
+	}
+
+	int Encoder::getPacketSize(int index) const
+	{
+		return sizes[index];
+	}
+
+	bool decodeHeader(const uint8_t *packet, int size, PacketHeader &header)
+	{
+		if (size < HeaderSize)
+		{
+			return false;
+		}
+
+		auto cursor = packet;
+		if (read16(cursor) != Magic || *cursor++ != Version)
+		{
+			return false;
+		}
+
+		header.flags = *cursor++;
+		header.batchSequence = read32(cursor);
+		header.dacIndex = read16(cursor);
+		header.packetIndex = read16(cursor);
+		header.packetCount = read16(cursor);
+		header.batchPointCount = read16(cursor);
+		header.firstPoint = read16(cursor);
+		header.pointCount = read16(cursor);
+
+		return header.packetIndex < header.packetCount
+			&& header.firstPoint + header.pointCount <= header.batchPointCount;
+	}
+
+	bool decodePoints(const uint8_t *packet, int size, const PacketHeader &header, PointBuffer &buffer)
+	{
+		auto cursor = packet + HeaderSize;
+		auto end = packet + size;
+		auto colorSize = getColorSize(header.flags);
+
+		int x = 0;
+		int y = 0;
+
+		for (int index = 0; index < header.pointCount; ++index)
+		{
+			if ((header.flags & DeltaPositions) && index > 0)
+			{
+				if (cursor + DeltaPositionSize > end)
+				{
+					return false;
+				}
+
+				auto dx = (int8_t)*cursor++;
+				if (dx == DeltaEscape)
+				{
+					if (cursor + AbsolutePositionSize > end)
+					{
+						return false;
+					}
+					x = (int16_t)read16(cursor);
+					y = (int16_t)read16(cursor);
+				}
+				else
+				{
+					x += dx;
+					y += (int8_t)*cursor++;
+				}
+			}
+			else
+			{
+				if (cursor + AbsolutePositionSize > end)
+				{
+					return false;
+				}
+				x = (int16_t)read16(cursor);
+				y = (int16_t)read16(cursor);
+			}
+
+			if (cursor + colorSize > end)
+			{
+				return false;
+			}
+
+			auto pointIndex = header.firstPoint + index;
+			buffer.x[pointIndex] = x / 32767.f;
+			buffer.y[pointIndex] = y / 32767.f;
+
+			if (header.flags & Color16)
+			{
+				buffer.r[pointIndex] = read16(cursor) / 65535.f;
+				buffer.g[pointIndex] = read16(cursor) / 65535.f;
+				buffer.b[pointIndex] = read16(cursor) / 65535.f;
+			}
+			else
+			{
+				buffer.r[pointIndex] = *cursor++ / 255.f;
+				buffer.g[pointIndex] = *cursor++ / 255.f;
+				buffer.b[pointIndex] = *cursor++ / 255.f;
+			}
+		}
+
+		return true;
+	}
+}
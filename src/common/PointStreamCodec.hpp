@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "PointBuffer.hpp"
+
+// Compact wire format used to send batches over the network.
+//
+// A batch is split into packets, each holding a contiguous range of points of a single DAC, so that losing a
+// packet only loses its own points. Every packet starts with a PacketHeader, followed by the points:
+// - positions are quantized to int16, either absolute or as int8 deltas from the previous point of the packet,
+// - colors are quantized to 8 or 16 bits per channel.
+// All integers are little-endian.
+namespace PointStreamCodec
+{
+	static const uint16_t Magic = 0x4445; // "ED"
+	static const uint8_t Version = 1;
+
+	enum Flags : uint8_t
+	{
+		Color16 = 1 << 0,
+		DeltaPositions = 1 << 1,
+	};
+
+	struct PacketHeader
+	{
+		uint8_t flags;
+		uint32_t batchSequence;
+		uint16_t dacIndex;
+		uint16_t packetIndex; // Among the packets of this DAC.
+		uint16_t packetCount;
+		uint16_t batchPointCount;
+		uint16_t firstPoint;
+		uint16_t pointCount;
+	};
+
+	static const int HeaderSize = 20;
+
+	// In delta mode, marks a point whose position did not fit in int8 deltas, and is stored as absolute int16.
+	static const int8_t DeltaEscape = -128;
+
+	class Encoder
+	{
+	public:
+		Encoder(int packetSize, bool color16, bool deltaPositions);
+
+		// Returns an upper bound of the number of packets needed for pointCount points.
+		int getMaxPacketCount(int pointCount) const;
+
+		// Discards the packets of the previous batch.
+		void clear();
+
+		// Appends the packets holding the points of a single DAC.
+		void encode(uint32_t batchSequence, uint16_t dacIndex, const PointBuffer &buffer);
+
+		int getPacketCount() const;
+		const uint8_t *getPacket(int index) const;
+		int getPacketSize(int index) const;
+
+		// Packet storage is only allocated by this method, call it beforehand to avoid reallocations while streaming.
+		void reserve(int packetCount);
+
+	private:
+		int packetSize;
+		uint8_t flags;
+
+		std::vector<uint8_t> data;
+		std::vector<int> sizes;
+	};
+
+	// Parses a packet header, returns false if the packet is malformed.
+	bool decodeHeader(const uint8_t *packet, int size, PacketHeader &header);
+
+	// Writes the points of the packet from index header.firstPoint, returns false if the packet is malformed.
+	bool decodePoints(const uint8_t *packet, int size, const PacketHeader &header, PointBuffer &buffer);
+}
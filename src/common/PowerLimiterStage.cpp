@@ -0,0 +1,80 @@
+#include "PowerLimiterStage.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Diagonal of the field, which bounds the travel between two points once the DAC has clamped them.
+static const float MaxDistance = 2.828f;
+
+PowerLimiterStage::PowerLimiterStage(int pointsPerSecond, float window, float minSpeed, float maxAveragePower)
+	: powerPerDistance{ (double)pointsPerSecond / minSpeed }
+{
+	auto windowPointCount = std::max(1, (int)std::lround(window * pointsPerSecond));
+	maxWindowPower = (int64_t)std::floor((double)maxAveragePower * windowPointCount * (1 << FixedPointBits));
+	powers.assign(windowPointCount, 0);
+	distances.assign(windowPointCount, 0);
+}
+
+bool PowerLimiterStage::isPointwise() const
+{
+	// Points depend on the previous ones.
+	return false;
+}
+
+void PowerLimiterStage::process(const PointBuffer &input, PointBuffer &output)
+{
+	auto windowPointCount = (int)powers.size();
+	auto fixedPointScale = (float)(1 << FixedPointBits);
+
+	for (int i = 0; i < input.count; ++i)
+	{
+		auto point = input.get(i);
+
+		// A point with a non-finite value is blanked. The beam position being unknown, it is not counted as
+		// travelled, and the next distance is measured from the previous point.
+		auto finite = std::isfinite(point.x) && std::isfinite(point.y) && std::isfinite(point.r) && std::isfinite(point.g) && std::isfinite(point.b);
+		if (!finite)
+		{
+			point.r = 0.f;
+			point.g = 0.f;
+			point.b = 0.f;
+		}
+
+		int32_t distance = 0;
+		if (finite)
+		{
+			auto dx = point.x - previousX;
+			auto dy = point.y - previousY;
+			previousX = point.x;
+			previousY = point.y;
+			distance = (int32_t)(std::min(std::sqrt(dx * dx + dy * dy), MaxDistance) * fixedPointScale);
+		}
+
+		auto power = (int32_t)(std::min(std::max(std::max(point.r, std::max(point.g, point.b)), 0.f), 1.f) * fixedPointScale);
+
+		// Slides the window.
+		powerSum -= powers[head];
+		distanceSum += distance - distances[head];
+		distances[head] = distance;
+
+		auto maxPowerByDistance = (int64_t)std::floor(distanceSum * powerPerDistance);
+		auto remainingPower = std::max<int64_t>(0, std::min(maxPowerByDistance, maxWindowPower) - powerSum);
+		auto deliveredPower = (int32_t)std::min<int64_t>(power, remainingPower);
+
+		powers[head] = deliveredPower;
+		powerSum += deliveredPower;
+		head = (head + 1 == windowPointCount) ? 0 : head + 1;
+
+		if (deliveredPower < power)
+		{
+			auto factor = (float)deliveredPower / power;
+			point.r *= factor;
+			point.g *= factor;
+			point.b *= factor;
+		}
+
+		output.set(i, point);
+	}
+
+	output.count = input.count;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "PointStage.hpp"
+
+// Attenuates colors when the beam concentrates too much energy, over a sliding window of the latest points.
+//
+// The power of a point is its brightest channel. Two limits apply to the delivered power summed over the window:
+// - the energy per distance travelled, which allows full power at minSpeed (units/s) and none for a static beam;
+// - the average power, as a fraction of full power.
+// Each point gets at most the power remaining under both limits, and its delivered power enters the window. Distances
+// are capped to the field diagonal, and points with a non-finite value are blanked.
+//
+// Sums are kept in integers, so that the output only depends on the input stream, whatever the batch sizes.
+//
+// The window is not reset with the pipeline, the power delivered before still counting against the next points.
+class PowerLimiterStage : public PointStage
+{
+public:
+	PowerLimiterStage(int pointsPerSecond, float window, float minSpeed, float maxAveragePower);
+
+	bool isPointwise() const override;
+	void process(const PointBuffer &input, PointBuffer &output) override;
+
+private:
+	// Powers and distances are stored with this many fractional bits.
+	static const int FixedPointBits = 16;
+
+	double powerPerDistance;
+	int64_t maxWindowPower;
+
+	// Ring buffers of the window, in fixed point.
+	std::vector<int32_t> powers;
+	std::vector<int32_t> distances;
+	int head{ 0 };
+	int64_t powerSum{ 0 };
+	int64_t distanceSum{ 0 };
+
+	float previousX{ 0.f };
+	float previousY{ 0.f };
+};
@@ -0,0 +1,116 @@
+#include "RenderProfiler.hpp"
+
+#include <algorithm>
+
+#include "BatchArena.hpp"
+#include "system.hpp"
+
+static int64_t getPercentile(std::vector<int64_t> &durations, int percent)
+{
+	std::sort(durations.begin(), durations.end());
+	return durations[(durations.size() - 1) * percent / 100];
+}
+
+double RenderProfiler::Measurement::getSustainedRate(float headroom) const
+{
+	return pointCount * 1e9 / (std::max(total.percentileDuration, (int64_t)1) * (1. + headroom));
+}
+
+RenderProfiler::RenderProfiler(Program &program, int dacCount)
+	: program(program)
+	, dacCount{ dacCount }
+{
+}
+
+RenderProfiler::Measurement RenderProfiler::measure(int pointCount, float duration, const Consumer &consumer)
+{
+	auto totalPointCount = pointCount * dacCount;
+
+	// Released after measuring, unlike the batch arena.
+	BatchArena arena{ false };
+	PointTexture pointTextureXY{ 2, GL_RG32F, totalPointCount, arena };
+	PointTexture pointTextureRGB{ 3, GL_RGB32F, totalPointCount, arena };
+
+	Framebuffer framebuffer{
+		pointTextureXY,
+		pointTextureRGB,
+	};
+
+	Quad quad{ totalPointCount };
+	glViewport(0, 0, totalPointCount, 1);
+
+	float *pointsXY = nullptr;
+	float *pointsRGB = nullptr;
+
+	std::vector<std::function<void()>> steps{
+		[&]()
+		{
+			program.incrementBase(totalPointCount);
+			program.setTime((float)systemGetTime());
+			quad.render();
+			glFinish();
+		},
+		[&]()
+		{
+			pointsXY = pointTextureXY.readPixels(GL_RG);
+			pointsRGB = pointTextureRGB.readPixels(GL_RGB);
+		},
+	};
+
+	if (consumer)
+	{
+		steps.push_back([&]()
+		{
+			consumer(pointsXY, pointsRGB);
+		});
+	}
+
+	auto timings = measureSteps(steps, duration);
+
+	Measurement measurement;
+	measurement.pointCount = pointCount;
+	measurement.render = timings[0];
+	measurement.readback = timings[1];
+	measurement.total = timings.back();
+	return measurement;
+}
+
+std::vector<RenderProfiler::Timing> RenderProfiler::measureSteps(const std::vector<std::function<void()>> &steps, float duration)
+{
+	// Per step, then for the batch.
+	std::vector<std::vector<int64_t>> durations(steps.size() + 1);
+
+	auto endTime = systemGetTimeNanoseconds() + (int64_t)(duration * 1e9);
+	for (int batchIndex = 0; batchIndex < WarmupBatchCount + MinBatchCount || systemGetTimeNanoseconds() < endTime; ++batchIndex)
+	{
+		auto startTime = systemGetTimeNanoseconds();
+		auto stepStartTime = startTime;
+		for (std::size_t stepIndex = 0; stepIndex < steps.size(); ++stepIndex)
+		{
+			steps[stepIndex]();
+
+			auto stepEndTime = systemGetTimeNanoseconds();
+			if (batchIndex >= WarmupBatchCount)
+			{
+				durations[stepIndex].push_back(stepEndTime - stepStartTime);
+			}
+			stepStartTime = stepEndTime;
+		}
+
+		if (batchIndex >= WarmupBatchCount)
+		{
+			durations.back().push_back(stepStartTime - startTime);
+		}
+	}
+
+	std::vector<Timing> timings;
+	for (auto &stepDurations : durations)
+	{
+		Timing timing;
+		timing.batchCount = (int)stepDurations.size();
+		timing.medianDuration = getPercentile(stepDurations, 50);
+		timing.percentileDuration = getPercentile(stepDurations, 95);
+		timings.push_back(timing);
+	}
+	return timings;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "opengl.hpp"
+
+// Measures how long a program takes to render and read back batches, like the main loop does, to find which
+// batch sizes and laser rates it sustains.
+class RenderProfiler
+{
+public:
+	struct Timing
+	{
+		int batchCount;
+
+		// In nanoseconds, per batch.
+		int64_t medianDuration;
+		int64_t percentileDuration; // 95th percentile.
+	};
+
+	struct Measurement
+	{
+		int pointCount; // Per DAC.
+
+		// Rendering is synchronized with glFinish(), so that it is not counted in the readback.
+		Timing render;
+		Timing readback;
+		Timing total;
+
+		// Points per second per DAC which the program sustains while using 1 / (1 + headroom) of the time.
+		double getSustainedRate(float headroom) const;
+	};
+
+	// Called with the readback of each batch, e.g. to process it like the main loop does.
+	typedef std::function<void(const float *pointsXY, const float *pointsRGB)> Consumer;
+
+	// Batches run before measuring, e.g. for the driver to finish compiling.
+	static const int WarmupBatchCount = 3;
+	static const int MinBatchCount = 10;
+
+	// The program must be linked.
+	RenderProfiler(Program &program, int dacCount);
+
+	// Renders batches of pointCount points per DAC for at least duration seconds. The consumer, if any, is counted
+	// in the total.
+	Measurement measure(int pointCount, float duration, const Consumer &consumer = nullptr);
+
+	// Runs the steps one after the other as a batch, for at least duration seconds. Returns the timing of each
+	// step, then of the whole batch.
+	static std::vector<Timing> measureSteps(const std::vector<std::function<void()>> &steps, float duration);
+
+private:
+	Program &program;
+	int dacCount;
+};
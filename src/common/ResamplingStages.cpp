@@ -0,0 +1,298 @@
+#include "ResamplingStages.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "simd.hpp"
+
+static void getLinearWeights(float fraction, float weights[4])
+{
+	weights[0] = 0.f;
+	weights[1] = 1.f - fraction;
+	weights[2] = fraction;
+	weights[3] = 0.f;
+}
+
+static void getCatmullRomWeights(float fraction, float weights[4])
+{
+	auto f2 = fraction * fraction;
+	auto f3 = f2 * fraction;
+	weights[0] = .5f * (-f3 + 2.f * f2 - fraction);
+	weights[1] = .5f * (3.f * f3 - 5.f * f2 + 2.f);
+	weights[2] = .5f * (-3.f * f3 + 4.f * f2 + fraction);
+	weights[3] = .5f * (f3 - f2);
+}
+
+ResamplingStage::ResamplingStage(float ratio, Interpolation interpolation)
+	: ratio{ ratio }
+	, step{ 1.f / ratio }
+	, interpolation{ interpolation }
+{
+}
+
+bool ResamplingStage::isPointwise() const
+{
+	return false;
+}
+
+int ResamplingStage::getMaxOutputCount(int inputCount) const
+{
+	return (int)std::ceil(inputCount * ratio) + 2;
+}
+
+void ResamplingStage::interpolate(PointBuffer &output, int outputCount) const
+{
+	float *inputChannels[] = { sequence.x, sequence.y, sequence.r, sequence.g, sequence.b };
+	float *outputChannels[] = { output.x, output.y, output.r, output.g, output.b };
+	auto start = (float)position;
+
+	int index = 0;
+#if defined(SIMD_SSE2)
+	auto starts = _mm_set1_ps(start);
+	auto steps = _mm_set1_ps(step);
+	auto lanes = _mm_set_ps(3.f, 2.f, 1.f, 0.f);
+	auto halves = _mm_set1_ps(.5f);
+	auto ones = _mm_set1_ps(1.f);
+	for (; index + 4 <= outputCount; index += 4)
+	{
+		auto positions = _mm_add_ps(starts, _mm_mul_ps(_mm_add_ps(_mm_set1_ps((float)index), lanes), steps));
+		auto integers = _mm_cvttps_epi32(positions);
+		auto f = _mm_sub_ps(positions, _mm_cvtepi32_ps(integers));
+
+		__m128 w0, w1, w2, w3;
+		if (interpolation == Interpolation::CatmullRom)
+		{
+			auto f2 = _mm_mul_ps(f, f);
+			auto f3 = _mm_mul_ps(f2, f);
+			w0 = _mm_mul_ps(halves, _mm_sub_ps(_mm_sub_ps(_mm_add_ps(f2, f2), f3), f));
+			w1 = _mm_mul_ps(halves, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_set1_ps(3.f), f3), _mm_mul_ps(_mm_set1_ps(5.f), f2)), _mm_set1_ps(2.f)));
+			w2 = _mm_mul_ps(halves, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_set1_ps(4.f), f2), _mm_mul_ps(_mm_set1_ps(3.f), f3)), f));
+			w3 = _mm_mul_ps(halves, _mm_sub_ps(f3, f2));
+		}
+		else
+		{
+			w0 = _mm_setzero_ps();
+			w1 = _mm_sub_ps(ones, f);
+			w2 = f;
+			w3 = _mm_setzero_ps();
+		}
+
+		alignas(16) int32_t indices[4];
+		_mm_store_si128((__m128i *)indices, integers);
+
+		for (int channel = 0; channel < 5; ++channel)
+		{
+			auto values = inputChannels[channel];
+			auto sum = _mm_mul_ps(w1, _mm_set_ps(values[indices[3]], values[indices[2]], values[indices[1]], values[indices[0]]));
+			sum = _mm_add_ps(sum, _mm_mul_ps(w2, _mm_set_ps(values[indices[3] + 1], values[indices[2] + 1], values[indices[1] + 1], values[indices[0] + 1])));
+			if (interpolation == Interpolation::CatmullRom)
+			{
+				sum = _mm_add_ps(sum, _mm_mul_ps(w0, _mm_set_ps(values[indices[3] - 1], values[indices[2] - 1], values[indices[1] - 1], values[indices[0] - 1])));
+				sum = _mm_add_ps(sum, _mm_mul_ps(w3, _mm_set_ps(values[indices[3] + 2], values[indices[2] + 2], values[indices[1] + 2], values[indices[0] + 2])));
+			}
+			_mm_storeu_ps(outputChannels[channel] + output.count + index, sum);
+		}
+	}
+#endif
+	for (; index < outputCount; ++index)
+	{
+		auto position = start + index * step;
+		auto integer = (int)position;
+
+		float weights[4];
+		if (interpolation == Interpolation::CatmullRom)
+		{
+			getCatmullRomWeights(position - integer, weights);
+		}
+		else
+		{
+			getLinearWeights(position - integer, weights);
+		}
+
+		for (int channel = 0; channel < 5; ++channel)
+		{
+			auto values = inputChannels[channel] + integer - 1;
+			outputChannels[channel][output.count + index] = weights[0] * values[0] + weights[1] * values[1] + weights[2] * values[2] + weights[3] * values[3];
+		}
+	}
+}
+
+void ResamplingStage::allocate(int maxInputCount, BatchArena &arena)
+{
+	// Only called before processing, there is no history yet.
+	auto count = HistoryCount + maxInputCount;
+	if (sequence.getCapacity() < count)
+	{
+		sequence = PointBuffer{ count, arena };
+	}
+}
+
+void ResamplingStage::process(const PointBuffer &input, PointBuffer &output)
+{
+	output.count = 0;
+
+	if (input.count == 0)
+	{
+		return;
+	}
+
+	auto count = HistoryCount + input.count;
+	if (sequence.getCapacity() < count)
+	{
+		auto previousSequence = std::move(sequence);
+		sequence = PointBuffer{ count };
+		for (int index = 0; index < HistoryCount && hasHistory; ++index)
+		{
+			sequence.set(index, previousSequence.get(index));
+		}
+	}
+
+	if (!hasHistory)
+	{
+		for (int index = 0; index < HistoryCount; ++index)
+		{
+			sequence.set(index, input.get(0));
+		}
+		hasHistory = true;
+	}
+
+	std::copy(input.x, input.x + input.count, sequence.x + HistoryCount);
+	std::copy(input.y, input.y + input.count, sequence.y + HistoryCount);
+	std::copy(input.r, input.r + input.count, sequence.r + HistoryCount);
+	std::copy(input.g, input.g + input.count, sequence.g + HistoryCount);
+	std::copy(input.b, input.b + input.count, sequence.b + HistoryCount);
+
+	// Segments [i, i + 1] can be interpolated for i in [1, count - 3].
+	auto limit = (double)(count - 2);
+	auto outputCount = std::max(0, (int)std::ceil((limit - position) / step));
+	while (outputCount > 0 && position + (outputCount - 1) * (double)step >= limit)
+	{
+		--outputCount;
+	}
+
+	interpolate(output, outputCount);
+	output.count += outputCount;
+
+	position += outputCount * (double)step - input.count;
+	for (int index = 0; index < HistoryCount; ++index)
+	{
+		sequence.set(index, sequence.get(input.count + index));
+	}
+}
+
+void ResamplingStage::reset()
+{
+	position = 1.;
+	hasHistory = false;
+}
+
+ArcLengthResamplingStage::ArcLengthResamplingStage(float spacing, float minRatio, float maxRatio)
+	: spacing{ spacing }
+	, minRatio{ minRatio }
+	, maxRatio{ maxRatio }
+{
+}
+
+bool ArcLengthResamplingStage::isPointwise() const
+{
+	return false;
+}
+
+int ArcLengthResamplingStage::getMaxOutputCount(int inputCount) const
+{
+	return (int)std::ceil(inputCount * maxRatio);
+}
+
+void ArcLengthResamplingStage::allocate(int maxInputCount, BatchArena &)
+{
+	lengths.reserve(maxInputCount);
+}
+
+void ArcLengthResamplingStage::process(const PointBuffer &input, PointBuffer &output)
+{
+	output.count = 0;
+
+	if (input.count == 0)
+	{
+		return;
+	}
+
+	if (!hasPreviousPoint)
+	{
+		previousPoint = input.get(0);
+		hasPreviousPoint = true;
+	}
+
+	// Segment lengths are independent, unlike the walk along them.
+	lengths.resize(input.count);
+	auto x = input.x;
+	auto y = input.y;
+
+	auto dx = x[0] - previousPoint.x;
+	auto dy = y[0] - previousPoint.y;
+	lengths[0] = std::sqrt(dx * dx + dy * dy);
+
+	int index = 1;
+#if defined(SIMD_SSE2)
+	for (; index + 4 <= input.count; index += 4)
+	{
+		auto dxs = _mm_sub_ps(_mm_loadu_ps(x + index), _mm_loadu_ps(x + index - 1));
+		auto dys = _mm_sub_ps(_mm_loadu_ps(y + index), _mm_loadu_ps(y + index - 1));
+		_mm_storeu_ps(lengths.data() + index, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dxs, dxs), _mm_mul_ps(dys, dys))));
+	}
+#endif
+	for (; index < input.count; ++index)
+	{
+		dx = x[index] - x[index - 1];
+		dy = y[index] - y[index - 1];
+		lengths[index] = std::sqrt(dx * dx + dy * dy);
+	}
+
+	auto maxOutputCount = getMaxOutputCount(input.count);
+	auto minOutputCount = std::min((int)std::ceil(input.count * minRatio), maxOutputCount);
+
+	// Spacing of this batch, reduced if the path is too short for minOutputCount points.
+	auto totalLength = std::accumulate(lengths.begin(), lengths.end(), 0.f);
+	auto batchSpacing = spacing;
+	if (minOutputCount > 0 && totalLength > 0.f)
+	{
+		batchSpacing = std::min(spacing, totalLength / minOutputCount);
+	}
+	remainingDistance = std::min(remainingDistance, batchSpacing);
+
+	for (index = 0; index < input.count; ++index)
+	{
+		auto point = input.get(index);
+		auto length = lengths[index];
+
+		while (remainingDistance <= length && output.count < maxOutputCount)
+		{
+			auto f = length > 0.f ? remainingDistance / length : 1.f;
+			output.set(output.count++, Point{
+				previousPoint.x + (point.x - previousPoint.x) * f,
+				previousPoint.y + (point.y - previousPoint.y) * f,
+				previousPoint.r + (point.r - previousPoint.r) * f,
+				previousPoint.g + (point.g - previousPoint.g) * f,
+				previousPoint.b + (point.b - previousPoint.b) * f,
+			});
+			remainingDistance += batchSpacing;
+		}
+
+		// When the budget is exhausted, the rest of the batch is skipped over.
+		remainingDistance = std::max(0.f, remainingDistance - length);
+		previousPoint = point;
+	}
+
+	// The beam dwells at the end of the batch for the missing points, e.g. all of them for a static beam.
+	while (output.count < minOutputCount)
+	{
+		output.set(output.count++, previousPoint);
+	}
+}
+
+void ArcLengthResamplingStage::reset()
+{
+	hasPreviousPoint = false;
+	remainingDistance = 0.f;
+}
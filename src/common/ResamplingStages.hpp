@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+
+#include "PointStage.hpp"
+
+// Resamples points at a constant rate, e.g. so that the shader renders fewer points than emitted.
+//
+// Outputs are interpolated between the input points, with a delay of two input points since Catmull-Rom needs
+// the two neighbours of each segment. The last input points are kept for the next batch.
+class ResamplingStage : public PointStage
+{
+public:
+	enum class Interpolation
+	{
+		Linear,
+		CatmullRom,
+	};
+
+	// Emits ratio output points per input point.
+	ResamplingStage(float ratio, Interpolation interpolation);
+
+	bool isPointwise() const override;
+	int getMaxOutputCount(int inputCount) const override;
+	void allocate(int maxInputCount, BatchArena &arena) override;
+	void process(const PointBuffer &input, PointBuffer &output) override;
+	void reset() override;
+
+private:
+	static const int HistoryCount = 3;
+
+	float ratio;
+	float step;
+	Interpolation interpolation;
+
+	// Position of the next output, in sequence indices.
+	double position{ 1. };
+	bool hasHistory{ false };
+
+	// History points, then input points.
+	PointBuffer sequence;
+
+	void interpolate(PointBuffer &output, int outputCount) const;
+};
+
+// Resamples points at a constant distance along the path, which downsamples dense regions and upsamples sparse
+// ones. Points closer than the spacing, e.g. dwell points, are dropped, so this goes before the path stage.
+//
+// So that a static or nearly static path does not shrink batches to a few points, the spacing is reduced on short
+// paths, and a static beam is repeated.
+class ArcLengthResamplingStage : public PointStage
+{
+public:
+	// Between minRatio and maxRatio output points are emitted per input point.
+	ArcLengthResamplingStage(float spacing, float minRatio, float maxRatio);
+
+	bool isPointwise() const override;
+	int getMaxOutputCount(int inputCount) const override;
+	void allocate(int maxInputCount, BatchArena &arena) override;
+	void process(const PointBuffer &input, PointBuffer &output) override;
+	void reset() override;
+
+private:
+	float spacing;
+	float minRatio;
+	float maxRatio;
+
+	Point previousPoint;
+	bool hasPreviousPoint{ false };
+
+	// Distance from the previous point to the next output.
+	float remainingDistance{ 0.f };
+
+	std::vector<float> lengths;
+};
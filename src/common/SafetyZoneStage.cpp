@@ -0,0 +1,296 @@
+#include "SafetyZoneStage.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "FileWatcher.hpp"
+
+namespace
+{
+	struct Vertex
+	{
+		float x, y;
+	};
+
+	using Polygon = std::vector<Vertex>;
+
+	class Rasterizer
+	{
+	public:
+		Rasterizer(std::vector<uint64_t> &words, int wordsPerRow, int resolution)
+			: words(words), wordsPerRow{ wordsPerRow }, resolution{ resolution }
+		{
+		}
+
+		// Positions outside the field use the nearest cell.
+		void set(int column, int row)
+		{
+			column = std::min(std::max(column, 0), resolution - 1);
+			row = std::min(std::max(row, 0), resolution - 1);
+			words[row * wordsPerRow + (column >> 6)] |= (uint64_t)1 << (column & 63);
+		}
+
+		// Marks every cell crossed by the segment, in grid coordinates.
+		void fillSegment(Vertex from, Vertex to)
+		{
+			auto column = (int)std::floor(from.x);
+			auto row = (int)std::floor(from.y);
+			auto lastColumn = (int)std::floor(to.x);
+			auto lastRow = (int)std::floor(to.y);
+
+			auto dx = to.x - from.x;
+			auto dy = to.y - from.y;
+			auto stepX = dx > 0.f ? 1 : -1;
+			auto stepY = dy > 0.f ? 1 : -1;
+			auto deltaX = dx != 0.f ? std::abs(1.f / dx) : INFINITY;
+			auto deltaY = dy != 0.f ? std::abs(1.f / dy) : INFINITY;
+			auto nextX = dx != 0.f ? ((dx > 0.f ? column + 1 - from.x : from.x - column) * deltaX) : INFINITY;
+			auto nextY = dy != 0.f ? ((dy > 0.f ? row + 1 - from.y : from.y - row) * deltaY) : INFINITY;
+
+			set(column, row);
+			auto stepCount = std::abs(lastColumn - column) + std::abs(lastRow - row);
+			for (int step = 0; step < stepCount; ++step)
+			{
+				if (nextX < nextY)
+				{
+					nextX += deltaX;
+					column += stepX;
+				}
+				else
+				{
+					nextY += deltaY;
+					row += stepY;
+				}
+				set(column, row);
+			}
+		}
+
+		// Marks every cell which a point of the edge falls into once clamped to the field. Clamping is affine between
+		// the crossings of the field borders, so the clamped edge is the polyline through the clamped crossings.
+		void fillEdge(Vertex from, Vertex to)
+		{
+			auto max = resolution - .5f;
+			const float bounds[] = { 0.f, max };
+
+			// Unused crossings are sorted after the others, being the maximum.
+			float crossings[6] = { 0.f, 1.f, 1.f, 1.f, 1.f, 1.f };
+			int crossingCount = 2;
+			for (auto bound : bounds)
+			{
+				if ((from.x < bound) != (to.x < bound))
+				{
+					crossings[crossingCount++] = (bound - from.x) / (to.x - from.x);
+				}
+				if ((from.y < bound) != (to.y < bound))
+				{
+					crossings[crossingCount++] = (bound - from.y) / (to.y - from.y);
+				}
+			}
+			std::sort(crossings, crossings + 6);
+
+			auto clamp = [&](float t)
+			{
+				Vertex vertex;
+				vertex.x = std::min(std::max(from.x + (to.x - from.x) * t, 0.f), max);
+				vertex.y = std::min(std::max(from.y + (to.y - from.y) * t, 0.f), max);
+				return vertex;
+			};
+
+			for (int index = 0; index + 1 < crossingCount; ++index)
+			{
+				fillSegment(clamp(crossings[index]), clamp(crossings[index + 1]));
+			}
+		}
+
+		// Marks cells whose center is inside the polygon, with the even-odd rule.
+		void fillInterior(const Polygon &polygon)
+		{
+			std::vector<float> crossings;
+			for (int row = 0; row < resolution; ++row)
+			{
+				auto y = row + .5f;
+				crossings.clear();
+				for (size_t index = 0; index < polygon.size(); ++index)
+				{
+					auto &a = polygon[index];
+					auto &b = polygon[(index + 1) % polygon.size()];
+					if ((a.y <= y) != (b.y <= y))
+					{
+						crossings.push_back(a.x + (y - a.y) / (b.y - a.y) * (b.x - a.x));
+					}
+				}
+				std::sort(crossings.begin(), crossings.end());
+
+				for (size_t index = 0; index + 1 < crossings.size(); index += 2)
+				{
+					// Clamped before conversion, crossings being unbounded.
+					auto first = (int)std::min(std::max(std::ceil(crossings[index] - .5f), 0.f), (float)resolution);
+					auto last = (int)std::min(std::max(std::floor(crossings[index + 1] - .5f), -1.f), resolution - 1.f);
+					for (int column = first; column <= last; ++column)
+					{
+						set(column, row);
+					}
+				}
+			}
+		}
+
+	private:
+		std::vector<uint64_t> &words;
+		int wordsPerRow;
+		int resolution;
+	};
+}
+
+SafetyZoneStage::SafetyZoneStage(const std::string &path, int resolution, FileWatcher *fileWatcher)
+	: path{ path }
+	, resolution{ resolution }
+{
+	if (fileWatcher)
+	{
+		fileWatcher->watchFile(path, [this]()
+		{
+			bool valid;
+			auto newMask = build(valid);
+
+			std::lock_guard<std::mutex> lock{ pendingMaskMutex };
+			pendingMask = std::move(newMask);
+			pendingMaskReady = true;
+		});
+	}
+}
+
+bool SafetyZoneStage::load()
+{
+	bool valid;
+	mask = build(valid);
+	return valid;
+}
+
+std::unique_ptr<SafetyZoneStage::Mask> SafetyZoneStage::build(bool &valid) const
+{
+	std::unique_ptr<Mask> newMask{ new Mask{} };
+	newMask->wordsPerRow = (resolution + 63) / 64;
+	newMask->words.assign(newMask->wordsPerRow * resolution, 0);
+
+	valid = false;
+	newMask->blankAll = true;
+
+	std::ifstream file{ path };
+	if (!file)
+	{
+		std::cerr << "Unable to open safety zone file: " << path << std::endl;
+		return newMask;
+	}
+
+	std::vector<Polygon> polygons;
+	std::string line;
+	while (std::getline(file, line))
+	{
+		line = line.substr(0, line.find('#'));
+
+		std::istringstream lineStream{ line };
+		std::vector<float> values;
+		float value;
+		while (lineStream >> value)
+		{
+			values.push_back(value);
+		}
+
+		if (!lineStream.eof() || values.size() % 2 != 0 || (!values.empty() && values.size() < 6))
+		{
+			std::cerr << "Invalid safety zone: " << line << std::endl;
+			return newMask;
+		}
+
+		Polygon polygon;
+		for (size_t index = 0; index < values.size(); index += 2)
+		{
+			polygon.push_back({ values[index], values[index + 1] });
+		}
+
+		if (!polygon.empty())
+		{
+			polygons.push_back(std::move(polygon));
+		}
+	}
+
+	Rasterizer rasterizer{ newMask->words, newMask->wordsPerRow, resolution };
+	auto scale = .5f * resolution;
+	for (auto &polygon : polygons)
+	{
+		// Grid coordinates. Vertices are not clamped, which would change the shape of the polygon: only the edges
+		// are, so that zones beyond the field mask the border cells which points beyond the field use.
+		for (auto &vertex : polygon)
+		{
+			vertex.x = (vertex.x + 1.f) * scale;
+			vertex.y = (vertex.y + 1.f) * scale;
+		}
+
+		for (size_t index = 0; index < polygon.size(); ++index)
+		{
+			rasterizer.fillEdge(polygon[index], polygon[(index + 1) % polygon.size()]);
+		}
+		rasterizer.fillInterior(polygon);
+	}
+
+	valid = true;
+	newMask->blankAll = false;
+	return newMask;
+}
+
+bool SafetyZoneStage::isPointwise() const
+{
+	return true;
+}
+
+void SafetyZoneStage::beginBatch()
+{
+	if (pendingMaskReady.exchange(false))
+	{
+		std::lock_guard<std::mutex> lock{ pendingMaskMutex };
+		mask = std::move(pendingMask);
+	}
+}
+
+bool SafetyZoneStage::hasPendingChange() const
+{
+	return pendingMaskReady;
+}
+
+void SafetyZoneStage::processRange(PointBuffer &buffer, int begin, int end)
+{
+	if (mask->blankAll)
+	{
+		std::fill(buffer.r + begin, buffer.r + end, 0.f);
+		std::fill(buffer.g + begin, buffer.g + end, 0.f);
+		std::fill(buffer.b + begin, buffer.b + end, 0.f);
+		return;
+	}
+
+	auto words = mask->words.data();
+	auto wordsPerRow = mask->wordsPerRow;
+	auto scale = .5f * resolution;
+	auto maxCell = (float)(resolution - 1);
+
+	for (int i = begin; i < end; ++i)
+	{
+		// Non-finite positions, e.g. from normalize(vec2(0)), would index out of the mask: they are looked up at the
+		// origin and blanked whatever the zones.
+		auto finite = std::isfinite(buffer.x[i]) && std::isfinite(buffer.y[i]);
+		auto x = finite ? buffer.x[i] : 0.f;
+		auto y = finite ? buffer.y[i] : 0.f;
+
+		auto column = (int)std::min(std::max((x + 1.f) * scale, 0.f), maxCell);
+		auto row = (int)std::min(std::max((y + 1.f) * scale, 0.f), maxCell);
+		auto masked = (words[row * wordsPerRow + (column >> 6)] >> (column & 63)) & 1;
+
+		// Branchless, so that the cost does not depend on the zones.
+		auto keep = (float)((int)finite & (1 - (int)masked));
+		buffer.r[i] *= keep;
+		buffer.g[i] *= keep;
+		buffer.b[i] *= keep;
+	}
+}
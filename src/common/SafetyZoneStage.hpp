@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "PointStage.hpp"
+
+class FileWatcher;
+
+// Blanks points inside zones, e.g. where the audience stands.
+//
+// The zone file holds one polygon per line, as "x0 y0 x1 y1 x2 y2 ..." positions. Text after # is ignored. Polygons
+// are rasterized into a bitmap covering (-1, 1)^2, conservatively: every cell touched by a polygon is masked, so
+// that testing a point is a single lookup. Positions outside the field use the nearest cell.
+//
+// The bitmap is rebuilt on the file watcher thread when the file changes, and swapped in before the next batch. If
+// the new content is invalid, every point is blanked until it is fixed.
+class SafetyZoneStage : public PointStage
+{
+public:
+	// fileWatcher may be null.
+	SafetyZoneStage(const std::string &path, int resolution, FileWatcher *fileWatcher);
+
+	// Returns false if the file is invalid.
+	bool load();
+
+	bool isPointwise() const override;
+	void beginBatch() override;
+	bool hasPendingChange() const override;
+	void processRange(PointBuffer &buffer, int begin, int end) override;
+
+private:
+	struct Mask
+	{
+		// One bit per cell, rows padded to whole words.
+		std::vector<uint64_t> words;
+		int wordsPerRow;
+		bool blankAll{ false };
+	};
+
+	std::string path;
+	int resolution;
+
+	std::unique_ptr<Mask> mask;
+	std::unique_ptr<Mask> pendingMask;
+	std::mutex pendingMaskMutex;
+	std::atomic<bool> pendingMaskReady{ false };
+
+	std::unique_ptr<Mask> build(bool &valid) const;
+};
@@ -0,0 +1,249 @@
+#include "ShaderPreprocessor.hpp"
+
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "FileWatcher.hpp"
+#include "system.hpp"
+
+// Returns the full path, or an empty string if the file does not exist.
+static std::string getFullPath(const std::string &path)
+{
+	auto namePair = systemSplitDirectoryNameAndBaseName(path);
+	return std::get<0>(namePair) + std::get<1>(namePair);
+}
+
+static std::string getDirectory(const std::string &fullPath)
+{
+	return std::get<0>(systemSplitDirectoryNameAndBaseName(fullPath));
+}
+
+// Returns whether the line is an #include directive, and its path.
+static bool parseInclude(const std::string &line, std::string &path)
+{
+	std::size_t position = 0;
+	auto skipSpaces = [&]()
+	{
+		while (position < line.size() && std::isspace((unsigned char)line[position]))
+		{
+			++position;
+		}
+	};
+
+	skipSpaces();
+	if (position >= line.size() || line[position] != '#')
+	{
+		return false;
+	}
+
+	++position;
+	skipSpaces();
+	if (line.compare(position, 7, "include") != 0)
+	{
+		return false;
+	}
+
+	position += 7;
+	skipSpaces();
+	if (position >= line.size() || line[position] != '"')
+	{
+		return false;
+	}
+
+	auto end = line.find('"', position + 1);
+	if (end == std::string::npos)
+	{
+		return false;
+	}
+
+	path = line.substr(position + 1, end - position - 1);
+	return true;
+}
+
+static bool isAbsolute(const std::string &path)
+{
+	return (!path.empty() && (path[0] == '/' || path[0] == '\\')) || (path.size() > 1 && path[1] == ':');
+}
+
+ShaderPreprocessor::ShaderPreprocessor(FileWatcher *fileWatcher, std::function<void()> changeCallback)
+	: fileWatcher{ fileWatcher }
+	, changeCallback{ changeCallback }
+{}
+
+bool ShaderPreprocessor::preprocess(const std::string &path, std::string &source)
+{
+	std::lock_guard<std::mutex> lock{ mutex };
+
+	std::vector<std::string> previousSourceNames;
+	std::swap(previousSourceNames, sourceNames);
+
+	std::unordered_set<std::string> includedPaths;
+	std::string expandedSource;
+	auto success = expand(path, path, includedPaths, expandedSource);
+
+	// Even if a file is missing, the others are watched, so that fixing the include is detected.
+	dependencies = std::move(includedPaths);
+
+	if (!success)
+	{
+		sourceNames = std::move(previousSourceNames);
+		return false;
+	}
+
+	source = std::move(expandedSource);
+	return true;
+}
+
+std::string ShaderPreprocessor::translateLog(const std::string &log) const
+{
+	std::istringstream stream{ log };
+	std::string result;
+	std::string line;
+	while (std::getline(stream, line))
+	{
+		// Drivers start lines with "0:12", "0(12)" or "ERROR: 0:12".
+		std::size_t position = 0;
+		for (auto prefix : { "ERROR: ", "WARNING: " })
+		{
+			auto length = std::char_traits<char>::length(prefix);
+			if (line.compare(0, length, prefix) == 0)
+			{
+				position = length;
+				break;
+			}
+		}
+
+		auto end = position;
+		while (end < line.size() && std::isdigit((unsigned char)line[end]))
+		{
+			++end;
+		}
+
+		if (end > position && end < line.size() && (line[end] == ':' || line[end] == '('))
+		{
+			auto index = std::stoul(line.substr(position, end - position));
+			if (index < sourceNames.size())
+			{
+				line.replace(position, end - position, sourceNames[index]);
+			}
+		}
+
+		result += line + '\n';
+	}
+	return result;
+}
+
+const ShaderPreprocessor::ParsedFile *ShaderPreprocessor::getParsedFile(const std::string &fullPath)
+{
+	auto it = parsedFileByPaths.find(fullPath);
+	if (it != std::end(parsedFileByPaths))
+	{
+		return &it->second;
+	}
+
+	std::ifstream file{ fullPath, std::ios::in | std::ios::binary };
+	if (!file)
+	{
+		return nullptr;
+	}
+
+	auto directory = getDirectory(fullPath);
+
+	ParsedFile parsedFile;
+	Chunk chunk;
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		++lineNumber;
+
+		std::string includePath;
+		if (parseInclude(line, includePath))
+		{
+			chunk.includePath = isAbsolute(includePath) ? includePath : directory + includePath;
+			chunk.includeLine = lineNumber;
+			parsedFile.chunks.push_back(std::move(chunk));
+			chunk = Chunk{};
+		}
+		else
+		{
+			chunk.text += line + '\n';
+		}
+	}
+	parsedFile.chunks.push_back(std::move(chunk));
+
+	return &parsedFileByPaths.emplace(fullPath, std::move(parsedFile)).first->second;
+}
+
+bool ShaderPreprocessor::expand(const std::string &path, const std::string &displayName, std::unordered_set<std::string> &includedPaths, std::string &source)
+{
+	auto fullPath = getFullPath(path);
+	auto parsedFile = fullPath.empty() ? nullptr : getParsedFile(fullPath);
+	if (!parsedFile)
+	{
+		std::cerr << "Unable to open shader file " << displayName << "." << std::endl;
+		return false;
+	}
+
+	includedPaths.insert(fullPath);
+
+	if (fileWatcher && watchedPaths.insert(fullPath).second)
+	{
+		fileWatcher->watchFile(fullPath, [this, fullPath]()
+		{
+			invalidate(fullPath);
+		});
+	}
+
+	auto sourceIndex = std::to_string(sourceNames.size());
+	sourceNames.push_back(displayName);
+
+	// Nothing may precede #version in the main file.
+	if (sourceIndex != "0")
+	{
+		source += "#line 1 " + sourceIndex + "\n";
+	}
+
+	for (auto &chunk : parsedFile->chunks)
+	{
+		source += chunk.text;
+
+		if (chunk.includePath.empty())
+		{
+			continue;
+		}
+
+		auto includedFullPath = getFullPath(chunk.includePath);
+		if (includedFullPath.empty() || includedPaths.find(includedFullPath) == std::end(includedPaths))
+		{
+			if (!expand(chunk.includePath, chunk.includePath, includedPaths, source))
+			{
+				std::cerr << "Included from " << displayName << ":" << chunk.includeLine << "." << std::endl;
+				return false;
+			}
+		}
+
+		source += "#line " + std::to_string(chunk.includeLine + 1) + " " + sourceIndex + "\n";
+	}
+
+	return true;
+}
+
+void ShaderPreprocessor::invalidate(const std::string &fullPath)
+{
+	bool dependent;
+
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		parsedFileByPaths.erase(fullPath);
+		dependent = dependencies.find(fullPath) != std::end(dependencies);
+	}
+
+	// A file which is no longer included only leaves the cache.
+	if (dependent)
+	{
+		changeCallback();
+	}
+}
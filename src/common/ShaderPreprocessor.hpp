@@ -0,0 +1,60 @@
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class FileWatcher;
+
+// Expands #include "path" directives, paths being relative to the including file. Each file is included once,
+// which also breaks cycles. Expanded files are numbered as GLSL source strings, 0 being the main file, and
+// #line directives keep line numbers, so that compilation logs can be mapped back to file names.
+//
+// Parsed files are cached until they change. Every file of the last expansion is watched, and changeCallback
+// is called, from the watcher thread, when one of them changes.
+class ShaderPreprocessor
+{
+public:
+	// fileWatcher may be null.
+	ShaderPreprocessor(FileWatcher *fileWatcher, std::function<void()> changeCallback);
+
+	// Returns false if a file cannot be read, source is then unchanged.
+	bool preprocess(const std::string &path, std::string &source);
+
+	// Replaces source string numbers with file paths in a compilation log.
+	std::string translateLog(const std::string &log) const;
+
+private:
+	struct Chunk
+	{
+		std::string text;
+
+		// The text is followed by this include, unless empty.
+		std::string includePath;
+		int includeLine;
+	};
+
+	struct ParsedFile
+	{
+		std::vector<Chunk> chunks;
+	};
+
+	FileWatcher *fileWatcher;
+	std::function<void()> changeCallback;
+
+	// Guards the cache and dependencies, which the watcher thread accesses.
+	std::mutex mutex;
+	std::unordered_map<std::string, ParsedFile> parsedFileByPaths;
+	std::unordered_set<std::string> dependencies;
+	std::unordered_set<std::string> watchedPaths;
+
+	// Per source string number.
+	std::vector<std::string> sourceNames;
+
+	const ParsedFile *getParsedFile(const std::string &fullPath);
+	bool expand(const std::string &path, const std::string &displayName, std::unordered_set<std::string> &includedPaths, std::string &source);
+	void invalidate(const std::string &fullPath);
+};
@@ -0,0 +1,119 @@
+#include "TransformStages.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+AffineStage AffineStage::offset(float x, float y)
+{
+	return AffineStage{ 1.f, 0.f, x, 0.f, 1.f, y };
+}
+
+AffineStage AffineStage::scale(float x, float y)
+{
+	return AffineStage{ x, 0.f, 0.f, 0.f, y, 0.f };
+}
+
+AffineStage AffineStage::rotate(float angle)
+{
+	auto c = std::cos(angle);
+	auto s = std::sin(angle);
+	return AffineStage{ c, -s, 0.f, s, c, 0.f };
+}
+
+AffineStage::AffineStage(float xx, float xy, float xo, float yx, float yy, float yo)
+	: xx{ xx }, xy{ xy }, xo{ xo }
+	, yx{ yx }, yy{ yy }, yo{ yo }
+{
+}
+
+bool AffineStage::isPointwise() const
+{
+	return true;
+}
+
+bool AffineStage::fuse(const PointStage &next)
+{
+	auto nextAffine = dynamic_cast<const AffineStage *>(&next);
+	if (!nextAffine)
+	{
+		return false;
+	}
+
+	// Composes next after this.
+	auto &n = *nextAffine;
+	*this = AffineStage{
+		n.xx * xx + n.xy * yx, n.xx * xy + n.xy * yy, n.xx * xo + n.xy * yo + n.xo,
+		n.yx * xx + n.yy * yx, n.yx * xy + n.yy * yy, n.yx * xo + n.yy * yo + n.yo,
+	};
+	return true;
+}
+
+void AffineStage::processRange(PointBuffer &buffer, int begin, int end)
+{
+	auto x = buffer.x;
+	auto y = buffer.y;
+
+	for (int i = begin; i < end; ++i)
+	{
+		auto px = x[i];
+		auto py = y[i];
+		x[i] = xx * px + xy * py + xo;
+		y[i] = yx * px + yy * py + yo;
+	}
+}
+
+ColorGainStage::ColorGainStage(float r, float g, float b)
+	: r{ r }, g{ g }, b{ b }
+{
+}
+
+bool ColorGainStage::isPointwise() const
+{
+	return true;
+}
+
+bool ColorGainStage::fuse(const PointStage &next)
+{
+	auto nextGain = dynamic_cast<const ColorGainStage *>(&next);
+	if (!nextGain)
+	{
+		return false;
+	}
+
+	r *= nextGain->r;
+	g *= nextGain->g;
+	b *= nextGain->b;
+	return true;
+}
+
+void ColorGainStage::processRange(PointBuffer &buffer, int begin, int end)
+{
+	for (int i = begin; i < end; ++i)
+	{
+		buffer.r[i] *= r;
+		buffer.g[i] *= g;
+		buffer.b[i] *= b;
+	}
+}
+
+bool ClampStage::isPointwise() const
+{
+	return true;
+}
+
+bool ClampStage::fuse(const PointStage &next)
+{
+	return dynamic_cast<const ClampStage *>(&next) != nullptr;
+}
+
+void ClampStage::processRange(PointBuffer &buffer, int begin, int end)
+{
+	for (int i = begin; i < end; ++i)
+	{
+		buffer.x[i] = std::min(std::max(buffer.x[i], -1.f), 1.f);
+		buffer.y[i] = std::min(std::max(buffer.y[i], -1.f), 1.f);
+		buffer.r[i] = std::min(std::max(buffer.r[i], 0.f), 1.f);
+		buffer.g[i] = std::min(std::max(buffer.g[i], 0.f), 1.f);
+		buffer.b[i] = std::min(std::max(buffer.b[i], 0.f), 1.f);
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "PointStage.hpp"
+
+// Affine transformation of positions: x' = xx * x + xy * y + xo, y' = yx * x + yy * y + yo.
+class AffineStage : public PointStage
+{
+public:
+	static AffineStage offset(float x, float y);
+	static AffineStage scale(float x, float y);
+	static AffineStage rotate(float angle);
+
+	AffineStage(float xx, float xy, float xo, float yx, float yy, float yo);
+
+	bool isPointwise() const override;
+	bool fuse(const PointStage &next) override;
+	void processRange(PointBuffer &buffer, int begin, int end) override;
+
+private:
+	float xx, xy, xo;
+	float yx, yy, yo;
+};
+
+// Multiplies colors by per-channel gains.
+class ColorGainStage : public PointStage
+{
+public:
+	ColorGainStage(float r, float g, float b);
+
+	bool isPointwise() const override;
+	bool fuse(const PointStage &next) override;
+	void processRange(PointBuffer &buffer, int begin, int end) override;
+
+private:
+	float r, g, b;
+};
+
+// Clamps positions to [-1, 1] and colors to [0, 1].
+class ClampStage : public PointStage
+{
+public:
+	bool isPointwise() const override;
+	bool fuse(const PointStage &next) override;
+	void processRange(PointBuffer &buffer, int begin, int end) override;
+};
@@ -0,0 +1,183 @@
+#include "UniformBlock.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+const char *const UniformBlock::BlockName = "UserUniforms";
+
+static bool isIdentifier(const std::string &name)
+{
+	if (name.empty() || std::isdigit((unsigned char)name[0]) || name.compare(0, 3, "gl_") == 0)
+	{
+		return false;
+	}
+
+	return std::all_of(name.begin(), name.end(), [](char c)
+	{
+		return std::isalnum((unsigned char)c) || c == '_';
+	});
+}
+
+bool UniformBlock::parse(const std::string &description, bool &layoutChanged)
+{
+	std::vector<std::pair<std::string, std::vector<float>>> definitions;
+
+	std::istringstream descriptionStream{ description };
+	std::string line;
+	while (std::getline(descriptionStream, line))
+	{
+		line = line.substr(0, line.find('#'));
+
+		std::istringstream lineStream{ line };
+		std::string definition;
+		while (std::getline(lineStream, definition, ';'))
+		{
+			std::replace(definition.begin(), definition.end(), ',', ' ');
+
+			std::istringstream definitionStream{ definition };
+			std::string name;
+			if (!(definitionStream >> name))
+			{
+				continue;
+			}
+
+			std::vector<float> values;
+			std::string value;
+			while (definitionStream >> value)
+			{
+				char *end;
+				values.push_back(std::strtof(value.c_str(), &end));
+				if (end == value.c_str() || *end != '\0')
+				{
+					values.clear();
+					break;
+				}
+			}
+
+			if (!isIdentifier(name) || values.empty() || values.size() > 4)
+			{
+				std::cerr << "Invalid uniform: " << definition << std::endl;
+				return false;
+			}
+
+			definitions.emplace_back(name, values);
+		}
+	}
+
+	layoutChanged = false;
+	for (auto &definition : definitions)
+	{
+		auto it = std::find_if(entries.begin(), entries.end(), [&](const Entry &entry)
+		{
+			return entry.name == definition.first;
+		});
+
+		auto componentCount = (int)definition.second.size();
+		if (it == entries.end())
+		{
+			entries.push_back(Entry{ definition.first, componentCount, -1 });
+			layoutChanged = true;
+		}
+		else if (it->componentCount != componentCount)
+		{
+			it->componentCount = componentCount;
+			layoutChanged = true;
+		}
+	}
+
+	if (layoutChanged)
+	{
+		layout();
+	}
+
+	for (auto &definition : definitions)
+	{
+		auto it = std::find_if(entries.begin(), entries.end(), [&](const Entry &entry)
+		{
+			return entry.name == definition.first;
+		});
+
+		if (!std::equal(definition.second.begin(), definition.second.end(), data.begin() + it->offset))
+		{
+			std::copy(definition.second.begin(), definition.second.end(), data.begin() + it->offset);
+			dirty = true;
+		}
+	}
+
+	return true;
+}
+
+void UniformBlock::layout()
+{
+	// std140: scalars are aligned on 4 bytes, vec2 on 8, vec3 and vec4 on 16. The block size is rounded to vec4.
+	std::vector<float> newData;
+	auto offset = 0;
+	for (auto &entry : entries)
+	{
+		auto alignment = entry.componentCount == 1 ? 1 : entry.componentCount == 2 ? 2 : 4;
+		offset = (offset + alignment - 1) / alignment * alignment;
+
+		newData.resize(offset + entry.componentCount, 0.f);
+
+		// Keeps previous values, resized entries being set afterwards anyway.
+		if (entry.offset >= 0)
+		{
+			auto previousCount = std::min(entry.componentCount, (int)data.size() - entry.offset);
+			std::copy(data.begin() + entry.offset, data.begin() + entry.offset + previousCount, newData.begin() + offset);
+		}
+
+		entry.offset = offset;
+		offset += entry.componentCount;
+	}
+
+	newData.resize((offset + 3) / 4 * 4, 0.f);
+	data = std::move(newData);
+	dirty = true;
+}
+
+bool UniformBlock::isEmpty() const
+{
+	return entries.empty();
+}
+
+std::string UniformBlock::getDeclaration() const
+{
+	if (entries.empty())
+	{
+		return std::string{};
+	}
+
+	static const char *const typeNames[] = { "float", "vec2", "vec3", "vec4" };
+
+	std::ostringstream declaration;
+	declaration << "layout(std140) uniform " << BlockName << " {";
+	for (auto &entry : entries)
+	{
+		declaration << " " << typeNames[entry.componentCount - 1] << " " << entry.name << ";";
+	}
+	declaration << " };\n";
+	return declaration.str();
+}
+
+const float *UniformBlock::getData() const
+{
+	return data.data();
+}
+
+int UniformBlock::getSize() const
+{
+	return (int)(data.size() * sizeof(float));
+}
+
+bool UniformBlock::isDirty() const
+{
+	return dirty;
+}
+
+void UniformBlock::clearDirty()
+{
+	dirty = false;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// User-defined uniforms, float to vec4, laid out as a std140 uniform block.
+//
+// The block declaration is generated for the fragment shader, and the values are only uploaded when they change.
+// Adding a uniform or changing its size changes the layout, which requires recompiling the shader.
+class UniformBlock
+{
+public:
+	static const char *const BlockName;
+
+	// Parses "name v0 v1 ..." definitions, separated by new lines or semicolons. Text after # is ignored.
+	// Returns false if the description is invalid, in which case no value is changed.
+	bool parse(const std::string &description, bool &layoutChanged);
+
+	bool isEmpty() const;
+
+	// Declaration to insert in shaders, empty if there is no uniform.
+	std::string getDeclaration() const;
+
+	const float *getData() const;
+	int getSize() const; // In bytes.
+
+	// Whether values changed since the last clearDirty().
+	bool isDirty() const;
+	void clearDirty();
+
+private:
+	struct Entry
+	{
+		std::string name;
+		int componentCount;
+		int offset; // In floats, -1 until laid out.
+	};
+
+	std::vector<Entry> entries;
+	std::vector<float> data;
+	bool dirty{ false };
+
+	void layout();
+};
@@ -0,0 +1,81 @@
+#include "WorkerPool.hpp"
+
+WorkerPool::WorkerPool(int workerCount)
+{
+	for (int workerIndex = 1; workerIndex < workerCount; ++workerIndex)
+	{
+		threads.emplace_back(&WorkerPool::work, this, workerIndex);
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		stopping = true;
+	}
+	startCondition.notify_all();
+
+	for (auto &thread : threads)
+	{
+		thread.join();
+	}
+}
+
+int WorkerPool::getWorkerCount() const
+{
+	return (int)threads.size() + 1;
+}
+
+void WorkerPool::run(const task_t &newTask)
+{
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		task = &newTask;
+		runningCount = (int)threads.size();
+		++generation;
+	}
+	startCondition.notify_all();
+
+	newTask(0);
+
+	std::unique_lock<std::mutex> lock{ mutex };
+	endCondition.wait(lock, [this]()
+	{
+		return runningCount == 0;
+	});
+	task = nullptr;
+}
+
+void WorkerPool::work(int workerIndex)
+{
+	unsigned lastGeneration = 0;
+
+	for (;;)
+	{
+		const task_t *currentTask;
+		{
+			std::unique_lock<std::mutex> lock{ mutex };
+			startCondition.wait(lock, [&]()
+			{
+				return stopping || generation != lastGeneration;
+			});
+
+			if (stopping)
+			{
+				return;
+			}
+
+			lastGeneration = generation;
+			currentTask = task;
+		}
+
+		(*currentTask)(workerIndex);
+
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			--runningCount;
+		}
+		endCondition.notify_one();
+	}
+}
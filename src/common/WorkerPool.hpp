@@ -0,0 +1,36 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs the same task on a fixed set of threads, the calling thread being worker 0.
+class WorkerPool
+{
+public:
+	using task_t = std::function<void(int workerIndex)>;
+
+	WorkerPool(int workerCount);
+	~WorkerPool();
+
+	int getWorkerCount() const;
+
+	// Returns once all workers have completed the task.
+	void run(const task_t &task);
+
+private:
+	std::vector<std::thread> threads;
+
+	std::mutex mutex;
+	std::condition_variable startCondition;
+	std::condition_variable endCondition;
+
+	const task_t *task{ nullptr };
+	unsigned generation{ 0 };
+	int runningCount{ 0 };
+	bool stopping{ false };
+
+	void work(int workerIndex);
+};
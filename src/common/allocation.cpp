@@ -0,0 +1,64 @@
+#include "allocation.hpp"
+
+#include <cstdlib>
+#include <new>
+
+// Replaces the global operators, so that allocations can be counted per thread at the cost of an increment.
+
+static thread_local uint64_t threadAllocationCount = 0;
+
+uint64_t allocationGetThreadCount()
+{
+	return threadAllocationCount;
+}
+
+static void *allocate(std::size_t size)
+{
+	++threadAllocationCount;
+	return std::malloc(size ? size : 1);
+}
+
+void *operator new(std::size_t size)
+{
+	auto address = allocate(size);
+	if (!address)
+	{
+		throw std::bad_alloc{};
+	}
+	return address;
+}
+
+void *operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+	return allocate(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+	return allocate(size);
+}
+
+void operator delete(void *address) noexcept
+{
+	std::free(address);
+}
+
+void operator delete[](void *address) noexcept
+{
+	std::free(address);
+}
+
+void operator delete(void *address, const std::nothrow_t &) noexcept
+{
+	std::free(address);
+}
+
+void operator delete[](void *address, const std::nothrow_t &) noexcept
+{
+	std::free(address);
+}
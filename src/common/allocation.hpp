@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstdint>
+
+// Number of heap allocations through operator new made by the calling thread so far, to check that the streaming
+// loop does not allocate. Allocations of C libraries and drivers are not counted.
+uint64_t allocationGetThreadCount();
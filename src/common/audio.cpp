@@ -0,0 +1,121 @@
+#include "audio.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static const uint16_t FormatPCM = 1;
+static const uint16_t FormatFloat = 3;
+static const uint16_t FormatExtensible = 0xFFFE;
+
+static uint32_t readLittleEndian(const uint8_t *bytes, int size)
+{
+	uint32_t value = 0;
+	for (int index = size - 1; index >= 0; --index)
+	{
+		value = (value << 8) | bytes[index];
+	}
+	return value;
+}
+
+static float decodeSample(const uint8_t *bytes, int bytesPerSample, uint16_t format)
+{
+	if (format == FormatFloat)
+	{
+		float value;
+		auto bits = readLittleEndian(bytes, 4);
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	// 8-bit samples are unsigned, others are signed.
+	if (bytesPerSample == 1)
+	{
+		return (bytes[0] - 128) / 128.f;
+	}
+
+	auto bits = bytesPerSample * 8;
+	auto value = (int32_t)(readLittleEndian(bytes, bytesPerSample) << (32 - bits));
+	return value / 2147483648.f;
+}
+
+bool audioReadWav(const std::string &path, std::vector<float> &samples, int &sampleRate)
+{
+	std::ifstream file{ path, std::ios::in | std::ios::binary };
+	if (!file)
+	{
+		std::cerr << "Unable to open audio file." << std::endl;
+		return false;
+	}
+
+	uint8_t riffHeader[12];
+	if (!file.read((char *)riffHeader, sizeof(riffHeader)) || std::memcmp(riffHeader, "RIFF", 4) != 0 || std::memcmp(riffHeader + 8, "WAVE", 4) != 0)
+	{
+		std::cerr << "Audio file is not a WAV file." << std::endl;
+		return false;
+	}
+
+	uint16_t format = 0;
+	int channelCount = 0;
+	int bytesPerSample = 0;
+	sampleRate = 0;
+
+	uint8_t chunkHeader[8];
+	while (file.read((char *)chunkHeader, sizeof(chunkHeader)))
+	{
+		auto chunkSize = readLittleEndian(chunkHeader + 4, 4);
+		std::vector<uint8_t> chunk(chunkSize);
+		if (!file.read((char *)chunk.data(), chunkSize))
+		{
+			break;
+		}
+
+		// Chunks are padded to even sizes.
+		if (chunkSize & 1)
+		{
+			file.ignore(1);
+		}
+
+		if (std::memcmp(chunkHeader, "fmt ", 4) == 0 && chunkSize >= 16)
+		{
+			format = (uint16_t)readLittleEndian(chunk.data(), 2);
+			channelCount = (int)readLittleEndian(chunk.data() + 2, 2);
+			sampleRate = (int)readLittleEndian(chunk.data() + 4, 4);
+			bytesPerSample = (int)readLittleEndian(chunk.data() + 14, 2) / 8;
+
+			// The actual format is the start of the sub-format GUID.
+			if (format == FormatExtensible && chunkSize >= 26)
+			{
+				format = (uint16_t)readLittleEndian(chunk.data() + 24, 2);
+			}
+		}
+		else if (std::memcmp(chunkHeader, "data", 4) == 0)
+		{
+			auto supported = (format == FormatPCM && bytesPerSample >= 1 && bytesPerSample <= 4) || (format == FormatFloat && bytesPerSample == 4);
+			if (!supported || channelCount < 1 || sampleRate <= 0)
+			{
+				std::cerr << "Unsupported audio format." << std::endl;
+				return false;
+			}
+
+			auto frameSize = bytesPerSample * channelCount;
+			auto frameCount = chunkSize / frameSize;
+			samples.resize(frameCount);
+			for (uint32_t frameIndex = 0; frameIndex < frameCount; ++frameIndex)
+			{
+				auto frame = chunk.data() + frameIndex * frameSize;
+				auto sum = 0.f;
+				for (int channel = 0; channel < channelCount; ++channel)
+				{
+					sum += decodeSample(frame + channel * bytesPerSample, bytesPerSample, format);
+				}
+				samples[frameIndex] = sum / channelCount;
+			}
+			return true;
+		}
+	}
+
+	std::cerr << "Audio file has no data." << std::endl;
+	return false;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Reads a WAV file, 8 to 32-bit integer or 32-bit float, downmixed to mono samples in [-1, 1].
+bool audioReadWav(const std::string &path, std::vector<float> &samples, int &sampleRate);
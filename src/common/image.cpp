@@ -0,0 +1,164 @@
+#include "image.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+static bool endsWith(const std::string &string, const std::string &suffix)
+{
+	return string.size() >= suffix.size() && string.compare(string.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static bool writePPM(const std::string &path, int width, int height, const uint8_t *pixels)
+{
+	std::ofstream file{ path, std::ios::out | std::ios::binary };
+	if (!file)
+	{
+		return false;
+	}
+
+	file << "P6\n" << width << " " << height << "\n255\n";
+	file.write((const char *)pixels, (std::streamsize)width * height * 3);
+	return (bool)file;
+}
+
+static uint32_t crc32(const uint8_t *data, std::size_t size, uint32_t crc = 0)
+{
+	crc = ~crc;
+	for (std::size_t i = 0; i < size; ++i)
+	{
+		crc ^= data[i];
+		for (int bit = 0; bit < 8; ++bit)
+		{
+			crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+		}
+	}
+	return ~crc;
+}
+
+static void append32(std::vector<uint8_t> &buffer, uint32_t value)
+{
+	buffer.push_back((uint8_t)(value >> 24));
+	buffer.push_back((uint8_t)(value >> 16));
+	buffer.push_back((uint8_t)(value >> 8));
+	buffer.push_back((uint8_t)value);
+}
+
+static void appendChunk(std::vector<uint8_t> &buffer, const char *type, const std::vector<uint8_t> &data)
+{
+	append32(buffer, (uint32_t)data.size());
+	auto typeOffset = buffer.size();
+	buffer.insert(buffer.end(), type, type + 4);
+	buffer.insert(buffer.end(), data.begin(), data.end());
+	append32(buffer, crc32(&buffer[typeOffset], buffer.size() - typeOffset));
+}
+
+// Uncompressed PNG: the deflate stream only uses stored blocks, which avoids depending on zlib.
+static bool writePNG(const std::string &path, int width, int height, const uint8_t *pixels)
+{
+	std::vector<uint8_t> raw;
+	auto rowSize = (std::size_t)width * 3;
+	raw.reserve((rowSize + 1) * height);
+	for (int y = 0; y < height; ++y)
+	{
+		raw.push_back(0); // No filter.
+		raw.insert(raw.end(), pixels + rowSize * y, pixels + rowSize * (y + 1));
+	}
+
+	std::vector<uint8_t> zlib{ 0x78, 0x01 };
+	uint32_t adlerA = 1;
+	uint32_t adlerB = 0;
+	const std::size_t maxBlockSize = 65535;
+	for (std::size_t offset = 0; offset < raw.size() || offset == 0; offset += maxBlockSize)
+	{
+		auto blockSize = std::min(maxBlockSize, raw.size() - offset);
+		auto last = offset + blockSize >= raw.size();
+		zlib.push_back(last ? 1 : 0);
+		zlib.push_back((uint8_t)blockSize);
+		zlib.push_back((uint8_t)(blockSize >> 8));
+		zlib.push_back((uint8_t)~blockSize);
+		zlib.push_back((uint8_t)(~blockSize >> 8));
+		zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+		if (last)
+		{
+			break;
+		}
+	}
+	for (auto byte : raw)
+	{
+		adlerA = (adlerA + byte) % 65521;
+		adlerB = (adlerB + adlerA) % 65521;
+	}
+	append32(zlib, (adlerB << 16) | adlerA);
+
+	std::vector<uint8_t> header;
+	append32(header, (uint32_t)width);
+	append32(header, (uint32_t)height);
+	header.push_back(8); // Bit depth.
+	header.push_back(2); // RGB.
+	header.push_back(0);
+	header.push_back(0);
+	header.push_back(0);
+
+	std::vector<uint8_t> buffer{ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	appendChunk(buffer, "IHDR", header);
+	appendChunk(buffer, "IDAT", zlib);
+	appendChunk(buffer, "IEND", {});
+
+	std::ofstream file{ path, std::ios::out | std::ios::binary };
+	if (!file)
+	{
+		return false;
+	}
+
+	file.write((const char *)buffer.data(), (std::streamsize)buffer.size());
+	return (bool)file;
+}
+
+bool imageWrite(const std::string &path, int width, int height, const uint8_t *pixels)
+{
+	if (endsWith(path, ".png"))
+	{
+		return writePNG(path, width, height, pixels);
+	}
+
+	return writePPM(path, width, height, pixels);
+}
+
+bool imageReadPfm(const std::string &path, int &width, int &height, int &components, std::vector<float> &pixels)
+{
+	std::ifstream file{ path, std::ios::in | std::ios::binary };
+	if (!file)
+	{
+		return false;
+	}
+
+	std::string magic;
+	float scale;
+	if (!(file >> magic >> width >> height >> scale) || (magic != "PF" && magic != "Pf") || width <= 0 || height <= 0)
+	{
+		return false;
+	}
+	file.get(); // Single whitespace before the data.
+
+	components = (magic == "PF") ? 3 : 1;
+	pixels.resize((std::size_t)width * height * components);
+	if (!file.read((char *)pixels.data(), (std::streamsize)(pixels.size() * sizeof(float))))
+	{
+		return false;
+	}
+
+	// A negative scale means little-endian data.
+	uint16_t probe = 1;
+	auto littleEndianHost = *(uint8_t *)&probe == 1;
+	if ((scale < 0.f) != littleEndianHost)
+	{
+		for (auto &pixel : pixels)
+		{
+			auto bytes = (uint8_t *)&pixel;
+			std::reverse(bytes, bytes + sizeof(float));
+		}
+	}
+
+	return true;
+}
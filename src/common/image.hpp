@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Writes 8-bit RGB pixels, row by row from the top. The format is chosen from the extension: .png or .ppm.
+bool imageWrite(const std::string &path, int width, int height, const uint8_t *pixels);
+
+// Reads a PFM file, grayscale or RGB float pixels, row by row from the bottom.
+bool imageReadPfm(const std::string &path, int &width, int &height, int &components, std::vector<float> &pixels);
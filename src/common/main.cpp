@@ -1,17 +1,37 @@
+#include <algorithm>
 #include <atomic>
 #include <cli.hpp>
 #include <cmath>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 
+#include "allocation.hpp"
+#include "AudioAnalysis.hpp"
+#include "BatchArena.hpp"
+#include "BeamSimulationOutput.hpp"
 #include "ConsoleOutput.hpp"
 #include "context.hpp"
 #include "FileWatcher.hpp"
+#include "image.hpp"
+#include "metrics.hpp"
+#include "NullOutput.hpp"
 #include "opengl.hpp"
+#include "OutputThread.hpp"
+#include "PointPipeline.hpp"
+#include "RenderProfiler.hpp"
+#include "ShaderPreprocessor.hpp"
 #include "system.hpp"
+#include "TransformStages.hpp"
+#include "UniformBlock.hpp"
 
 #if defined(SYSTEM_LINUX)
-// ...
+#include "../linux/MetricsServer.hpp"
+#include "../linux/SharedMemoryOutput.hpp"
+#include "../linux/UdpOutput.hpp"
+#include "../linux/UdpReceiver.hpp"
+#include "../linux/UniformSocket.hpp"
 #elif defined(SYSTEM_MACOSX)
 // ...
 #elif defined(SYSTEM_WINDOWS)
@@ -29,6 +49,8 @@ enum ExitCode
 	ExtensionsInitializationFailed,
 	FramebufferIncomplete,
 	InvalidShaderCode,
+	InputFailed,
+	SteadyStateAllocation,
 };
 
 static CommonParameters commonParameters;
@@ -38,29 +60,121 @@ static std::unique_ptr<Shader> fragmentShader;
 static std::unique_ptr<Program> program;
 
 static std::atomic<bool> shaderChanged{ false };
+static std::unique_ptr<ShaderPreprocessor> shaderPreprocessor;
+
+// Seconds between checks of a static batch being repeated by the output.
+static const float StaticPollingInterval = .01f;
 static std::unique_ptr<Output> output;
 
-bool compileProgram()
+static std::unique_ptr<BatchArena> batchArena;
+
+// With -check-allocations, batches which may allocate, e.g. growing codec buffers, before the loop is steady.
+static const int AllocationWarmupBatchCount = 16;
+static bool checkAllocations;
+
+// Startup calibration, empty, "report" or "auto".
+static std::string calibrationMode;
+static const int CalibrationMinPointCount = 64;
+static const float CalibrationDuration = .25f; // Per batch size, in seconds.
+static const float CalibrationHeadroom = .5f; // Rendering may take 1 / (1 + headroom) of the batch duration.
+
+// One per DAC.
+static std::vector<PointPipeline> pipelines;
+
+// Separate instances processing the watchdog fallback, so that it does not disturb the state of the others.
+static std::vector<PointPipeline> fallbackPipelines;
+
+static std::unique_ptr<AudioAnalysis> audioAnalysis;
+static float audioOffset;
+
+static UniformBlock uniformBlock;
+static std::string uniformFilePath;
+static std::atomic<bool> uniformFileChanged{ false };
+#if defined(SYSTEM_LINUX)
+static std::unique_ptr<UniformSocket> uniformSocket;
+static std::unique_ptr<MetricsServer> metricsServer;
+#endif
+
+// Uniforms are bound to this buffer binding point, and data textures to units from 1.
+static const GLuint UniformBlockBinding = 0;
+static const int FirstDataTextureUnit = 1;
+
+struct DataTextureSource
 {
-	std::ifstream shaderFile{ commonParameters.shaderPath, std::ios::in | std::ios::binary };
-	if (!shaderFile)
+	std::string name;
+	int width, height, components;
+	std::vector<float> pixels;
+};
+
+static std::vector<DataTextureSource> dataTextureSources;
+
+static ThreadSettings renderThreadSettings;
+static ThreadSettings outputThreadSettings;
+
+static float watchdogTimeout;
+static std::string fallbackPattern;
+
+bool readFile(const std::string &path, std::string &content)
+{
+	std::ifstream file{ path, std::ios::in | std::ios::binary };
+	if (!file)
 	{
-		std::cerr << "Unable to open shader." << std::endl;
 		return false;
 	}
 
+	file.seekg(0, std::ios::end);
+	content.resize((std::size_t)file.tellg());
+	file.seekg(0, std::ios::beg);
+	file.read(&content[0], content.size());
+	file.close();
+
+	return true;
+}
+
+// Declares user uniforms and data textures after the #version line, keeping line numbers.
+void insertDeclarations(std::string &source)
+{
+	auto declarations = uniformBlock.getDeclaration();
+	for (auto &textureSource : dataTextureSources)
+	{
+		declarations += "uniform sampler2D " + textureSource.name + ";\n";
+	}
+
+	if (declarations.empty())
+	{
+		return;
+	}
+
+	std::size_t position = 0;
+	auto nextLine = 1;
+	auto versionPosition = source.find("#version");
+	if (versionPosition != std::string::npos)
+	{
+		position = source.find('\n', versionPosition);
+		position = (position == std::string::npos) ? source.size() : position + 1;
+		nextLine = (int)std::count(source.begin(), source.begin() + position, '\n') + 1;
+	}
+
+	source.insert(position, declarations + "#line " + std::to_string(nextLine) + "\n");
+}
+
+bool buildProgram()
+{
 	std::string shaderSource;
+	if (!shaderPreprocessor->preprocess(commonParameters.shaderPath, shaderSource))
+	{
+		return false;
+	}
 
-	shaderFile.seekg(0, std::ios::end);
-	shaderSource.resize((std::size_t)shaderFile.tellg());
-	shaderFile.seekg(0, std::ios::beg);
-	shaderFile.read(&shaderSource[0], shaderSource.size());
-	shaderFile.close();
+	insertDeclarations(shaderSource);
 
 	std::unique_ptr<Shader> newFragmentShader{ new Shader{ GL_FRAGMENT_SHADER } };
 	std::unique_ptr<Program> newProgram{ new Program { *vertexShader, *newFragmentShader } };
 
-	newFragmentShader->compile(shaderSource);
+	newFragmentShader->compile(shaderSource, [](const std::string &log)
+	{
+		return shaderPreprocessor->translateLog(log);
+	});
 
 	if (!newProgram->link())
 	{
@@ -68,15 +182,280 @@ bool compileProgram()
 		return false;
 	}
 
+	newProgram->bindUniformBlock(UniformBlock::BlockName, UniformBlockBinding);
+	for (int index = 0; index < (int)dataTextureSources.size(); ++index)
+	{
+		newProgram->setSampler(dataTextureSources[index].name, FirstDataTextureUnit + index);
+	}
+
 	fragmentShader = std::move(newFragmentShader);
 	program = std::move(newProgram);
 	return true;
 }
 
+// Also records compilations, on reloads in particular, in the metrics.
+bool compileProgram()
+{
+	auto startTime = systemGetTimeNanoseconds();
+	auto compiled = buildProgram();
+	metricsObserve(MetricsHistogram::ShaderCompilationDuration, systemGetTimeNanoseconds() - startTime);
+
+	metricsIncrement(MetricsCounter::ShaderCompilations);
+	if (!compiled)
+	{
+		metricsIncrement(MetricsCounter::ShaderCompilationFailures);
+	}
+
+	return compiled;
+}
+
+// Applies changes from the uniform file and socket. New uniforms require recompiling the shader.
+void pollUniforms()
+{
+	auto layoutChanged = false;
+	std::string description;
+
+	if (uniformFileChanged.exchange(false))
+	{
+		if (!readFile(uniformFilePath, description))
+		{
+			std::cerr << "Unable to open uniform file." << std::endl;
+		}
+		else
+		{
+			auto changed = false;
+			uniformBlock.parse(description, changed);
+			layoutChanged |= changed;
+		}
+	}
+
+#if defined(SYSTEM_LINUX)
+	while (uniformSocket && uniformSocket->receive(description))
+	{
+		auto changed = false;
+		uniformBlock.parse(description, changed);
+		layoutChanged |= changed;
+	}
+#endif
+
+	if (layoutChanged)
+	{
+		shaderChanged = true;
+	}
+}
+
+// Batch streamed by the watchdog while rendering stalls: blank, or a dim circle showing that the system is alive.
+void renderFallback(PointBuffer &buffer, int count)
+{
+	static const float IdleRadius = .1f;
+	static const float IdleBrightness = .1f;
+
+	auto idle = (fallbackPattern == "idle");
+	for (int pointIndex = 0; pointIndex < count; ++pointIndex)
+	{
+		auto angle = (float)(2. * M_PI * pointIndex / count);
+		auto brightness = idle ? IdleBrightness : 0.f;
+		buffer.set(pointIndex, Point{ idle ? IdleRadius * std::cos(angle) : 0.f, idle ? IdleRadius * std::sin(angle) : 0.f, brightness, brightness, brightness });
+	}
+	buffer.count = count;
+}
+
+bool loadDataTextures(const std::string &description)
+{
+	std::istringstream descriptionStream{ description };
+	std::string definition;
+	while (std::getline(descriptionStream, definition, ';'))
+	{
+		std::istringstream definitionStream{ definition };
+		DataTextureSource textureSource;
+		std::string path;
+		if (!(definitionStream >> textureSource.name))
+		{
+			continue;
+		}
+
+		if (!(definitionStream >> path) || !imageReadPfm(path, textureSource.width, textureSource.height, textureSource.components, textureSource.pixels))
+		{
+			std::cerr << "Unable to load data texture: " << definition << std::endl;
+			return false;
+		}
+
+		dataTextureSources.push_back(std::move(textureSource));
+	}
+
+	return true;
+}
+
+void createVertexShader()
+{
+	vertexShader.reset(new Shader{ GL_VERTEX_SHADER });
+	vertexShader->compile(Quad::getVertexSource(commonParameters.pointCount));
+}
+
+// Renders the shader at increasing batch sizes and reports the rates it sustains. Returns the smallest batch size
+// up to -points which sustains -pps, for the lowest latency, or -points if none does.
+//
+// Batches are processed by the pipelines as in the main loop, since stages take time and may change the number of
+// emitted points, e.g. resample. Pipelines are allocated for -points: larger batches are only rendered, and are
+// assumed to keep the ratio of emitted to rendered points last observed.
+int calibrate(int maxPointCount)
+{
+	std::vector<int> pointCounts;
+	for (auto pointCount = CalibrationMinPointCount; pointCount < maxPointCount; pointCount *= 2)
+	{
+		pointCounts.push_back(pointCount);
+	}
+	pointCounts.push_back(maxPointCount);
+
+	if (std::find(pointCounts.begin(), pointCounts.end(), commonParameters.pointCount) == pointCounts.end())
+	{
+		pointCounts.push_back(commonParameters.pointCount);
+		std::sort(pointCounts.begin(), pointCounts.end());
+	}
+
+	std::cout << "Calibrating with " << CalibrationHeadroom * 100.f << "% headroom, times per batch:" << std::endl;
+	std::cout << std::setw(8) << "Points" << std::setw(12) << "Render" << std::setw(12) << "Readback" << std::setw(12) << "95%" << std::setw(16) << "Points/s" << std::endl;
+
+	auto selectedPointCount = commonParameters.pointCount;
+	auto found = false;
+	double maxRate = 0.;
+
+	auto bufferCapacity = PointPipeline::getMaxCapacity(pipelines, commonParameters.pointCount);
+	std::vector<PointBuffer> buffers;
+	for (int dacIndex = 0; dacIndex < commonParameters.dacCount; ++dacIndex)
+	{
+		buffers.emplace_back(bufferCapacity);
+	}
+
+	uint64_t renderedPointCount = 0;
+	uint64_t emittedPointCount = 0;
+	double emittedRatio = 1.;
+
+	RenderProfiler profiler{ *program, commonParameters.dacCount };
+	for (auto pointCount : pointCounts)
+	{
+		RenderProfiler::Consumer consumer;
+		if (pointCount <= commonParameters.pointCount)
+		{
+			consumer = [&](const float *pointsXY, const float *pointsRGB)
+			{
+				for (int dacIndex = 0; dacIndex < commonParameters.dacCount; ++dacIndex)
+				{
+					auto &buffer = buffers[dacIndex];
+					buffer.unpack(pointsXY + dacIndex * pointCount * 2, pointsRGB + dacIndex * pointCount * 3, pointCount);
+					pipelines[dacIndex].process(buffer);
+				}
+				PointPipeline::equalizeCounts(buffers);
+
+				renderedPointCount += pointCount;
+				emittedPointCount += buffers[0].count;
+			};
+		}
+
+		renderedPointCount = 0;
+		emittedPointCount = 0;
+		auto measurement = profiler.measure(pointCount, CalibrationDuration, consumer);
+		if (renderedPointCount > 0)
+		{
+			emittedRatio = (double)emittedPointCount / renderedPointCount;
+		}
+
+		// Emitted points, which -pps applies to.
+		auto rate = measurement.getSustainedRate(CalibrationHeadroom) * emittedRatio;
+		maxRate = std::max(maxRate, rate);
+
+		std::cout << std::fixed << std::setprecision(3)
+			<< std::setw(8) << pointCount
+			<< std::setw(9) << measurement.render.medianDuration * 1e-6 << " ms"
+			<< std::setw(9) << measurement.readback.medianDuration * 1e-6 << " ms"
+			<< std::setw(9) << measurement.total.percentileDuration * 1e-6 << " ms"
+			<< std::setw(16) << std::setprecision(0) << rate << std::endl;
+
+		if (!found && pointCount <= commonParameters.pointCount && rate >= commonParameters.pointsPerSecond)
+		{
+			selectedPointCount = pointCount;
+			found = true;
+		}
+	}
+
+	std::cout << "Sustained up to " << maxRate << " points per second per DAC." << std::endl;
+
+	// The stages continue from the main loop batches.
+	for (auto &pipeline : pipelines)
+	{
+		pipeline.reset();
+	}
+
+	if (found)
+	{
+		std::cout << "Smallest batch sustaining " << commonParameters.pointsPerSecond << " points per second: " << selectedPointCount << " points." << std::endl;
+	}
+	else
+	{
+		std::cerr << "No batch of up to " << commonParameters.pointCount << " points sustains " << commonParameters.pointsPerSecond << " points per second." << std::endl;
+	}
+
+	return selectedPointCount;
+}
+
 ExitCode run()
 {
-	PointTexture pointTextureXY{ 2, GL_RG32F, commonParameters.pointCount };
-	PointTexture pointTextureRGB{ 3, GL_RGB32F, commonParameters.pointCount };
+	GLint maxTextureSize;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+	if (commonParameters.pointCount * commonParameters.dacCount > maxTextureSize)
+	{
+		std::cerr << "Too many points, the maximum is " << maxTextureSize << " for all DACs." << std::endl;
+		return ExitCode::ParameterError;
+	}
+
+	UniformBuffer uniformBuffer{ UniformBlockBinding };
+
+	std::vector<std::unique_ptr<DataTexture>> dataTextures;
+	for (auto &textureSource : dataTextureSources)
+	{
+		dataTextures.emplace_back(new DataTexture{ textureSource.components, textureSource.width, textureSource.height, textureSource.pixels.data() });
+		dataTextures.back()->bind(FirstDataTextureUnit + (int)dataTextures.size() - 1);
+	}
+
+	createVertexShader();
+
+	if (!compileProgram())
+	{
+		return ExitCode::InvalidShaderCode;
+	}
+
+	if (!calibrationMode.empty())
+	{
+		if (uniformBlock.isDirty())
+		{
+			uniformBuffer.update(uniformBlock.getData(), uniformBlock.getSize());
+			uniformBlock.clearDirty();
+		}
+
+		auto pointCount = calibrate(maxTextureSize / commonParameters.dacCount);
+		if (calibrationMode == "report")
+		{
+			return ExitCode::Success;
+		}
+
+		// Buffers were allocated for -points, which is an upper bound.
+		if (pointCount != commonParameters.pointCount)
+		{
+			commonParameters.pointCount = pointCount;
+			createVertexShader();
+
+			if (!compileProgram())
+			{
+				return ExitCode::InvalidShaderCode;
+			}
+		}
+	}
+
+	// All DACs are rendered at once, side by side in the same textures.
+	auto totalPointCount = commonParameters.pointCount * commonParameters.dacCount;
+
+	PointTexture pointTextureXY{ 2, GL_RG32F, totalPointCount, *batchArena };
+	PointTexture pointTextureRGB{ 3, GL_RGB32F, totalPointCount, *batchArena };
 
 	Framebuffer framebuffer{
 		pointTextureXY,
@@ -89,35 +468,91 @@ ExitCode run()
 		return ExitCode::FramebufferIncomplete;
 	}
 
-	std::string vertexSource = "#version 330\n\
-		layout(location = 0) in vec2 aPosition;\n\
-		layout(location = 1) in float aOffset;\n\
-		out float index;\n\
-		uniform float base;\n\
-		void main() {\n\
-			gl_Position = vec4(aPosition, 0, 1);\n\
-			index = base + aOffset;\n\
-		}";
+	Quad quad{ totalPointCount };
 
-	vertexShader.reset(new Shader{ GL_VERTEX_SHADER });
-	vertexShader->compile(vertexSource);
+	glEnable(GL_CULL_FACE);
+	glViewport(0, 0, totalPointCount, 1);
 
-	if (!compileProgram())
+	auto bufferCapacity = PointPipeline::getMaxCapacity(pipelines, commonParameters.pointCount);
+
+	std::vector<PointBuffer> buffers;
+	for (int dacIndex = 0; dacIndex < commonParameters.dacCount; ++dacIndex)
 	{
-		return ExitCode::InvalidShaderCode;
+		buffers.emplace_back(bufferCapacity, *batchArena);
 	}
 
-	Quad quad{ commonParameters.pointCount };
+	// Points emitted per DAC, which gives the time in offline mode.
+	uint64_t emittedPointCount = 0;
 
-	glEnable(GL_CULL_FACE);
-	glViewport(0, 0, commonParameters.pointCount, 1);
+	// Static programs are only rendered once, the readback being reused.
+	float *pointsXY = nullptr;
+	float *pointsRGB = nullptr;
+	bool rendered = false;
 
-	auto points = std::unique_ptr<Point[]>(new Point[commonParameters.pointCount]);
+	// When the output repeats a static batch by itself, it is only sent again if the pipelines change it.
+	bool repeating = false;
+	uint64_t repeatedHash = 0;
+
+	// Meanwhile the DAC plays the batch continuously, so emitted points are counted from the clock since the
+	// repetition started.
+	double repeatStartTime = 0.;
+	uint64_t repeatStartPointCount = 0;
+
+	auto pauseRepeating = [&]()
+	{
+		systemPause(StaticPollingInterval);
+		emittedPointCount = repeatStartPointCount + (uint64_t)((systemGetTime() - repeatStartTime) * commonParameters.pointsPerSecond);
+	};
+
+	// Once all buffers are allocated.
+	if (renderThreadSettings.lockMemory && !systemLockMemory())
+	{
+		std::cerr << "Unable to lock memory, continuing unlocked." << std::endl;
+	}
+
+	applyThreadSettings(renderThreadSettings, "render");
 
 	systemStartTime();
 
+	OutputThread outputThread{ commonParameters, *output };
+
+	if (watchdogTimeout > 0.f)
+	{
+		// Processed like rendered points, e.g. to be kept out of safety zones.
+		std::vector<PointBuffer> fallbackBuffers;
+		for (int dacIndex = 0; dacIndex < commonParameters.dacCount; ++dacIndex)
+		{
+			fallbackBuffers.emplace_back(bufferCapacity, *batchArena);
+			renderFallback(fallbackBuffers.back(), commonParameters.pointCount);
+			fallbackPipelines[dacIndex].process(fallbackBuffers.back());
+		}
+		PointPipeline::equalizeCounts(fallbackBuffers);
+
+		outputThread.enableWatchdog(watchdogTimeout, fallbackBuffers);
+	}
+
+	if (checkAllocations)
+	{
+		outputThread.checkAllocations(AllocationWarmupBatchCount);
+	}
+
+	if (commonParameters.verbose)
+	{
+		std::cout << "Batch memory: " << batchArena->getReservedSize() / 1024 << " KB, of which " << batchArena->getHugePageSize() / 1024 << " KB on huge pages." << std::endl;
+	}
+
+	outputThread.start(outputThreadSettings);
+
+	auto exitCode = ExitCode::Success;
+	uint64_t pushedBatchCount = 0;
+
+	// Fallback batches have been streamed since the pipelines last processed a batch.
+	uint64_t stallCount = 0;
+
 	for (;;)
 	{
+		pollUniforms();
+
 		if (shaderChanged)
 		{
 			if (commonParameters.verbose)
@@ -128,42 +563,155 @@ ExitCode run()
 			shaderChanged = false;
 
 			compileProgram();
+			rendered = false;
 		}
 
 		if (program->isLinked())
 		{
-			program->incrementBase(commonParameters.pointCount);
-			program->updateTime();
+			auto emittedTime = (double)emittedPointCount / commonParameters.pointsPerSecond;
+			if (commonParameters.duration > 0.f && emittedTime >= commonParameters.duration)
+			{
+				break;
+			}
+
+			if (uniformBlock.isDirty())
+			{
+				uniformBuffer.update(uniformBlock.getData(), uniformBlock.getSize());
+				uniformBlock.clearDirty();
+				rendered = false;
+			}
+
+			// Rendering, processing and queuing a batch, which must not allocate.
+			auto allocationCount = allocationGetThreadCount();
+
+			auto animated = program->isAnimated();
+			auto renderedNow = animated || !rendered;
+			if (renderedNow)
+			{
+				program->incrementBase(totalPointCount);
+				program->setTime((float)(commonParameters.offline ? emittedTime : systemGetTime()));
+
+				if (audioAnalysis)
+				{
+					// The batch starts playing once the previous points are emitted.
+					float bands[AudioAnalysis::BandCount];
+					float onset;
+					audioAnalysis->sample(emittedTime + audioOffset, bands, onset);
+					program->setAudio(bands, AudioAnalysis::BandCount, onset);
+				}
+
+				auto renderStartTime = systemGetTimeNanoseconds();
+
+				quad.render();
 
-			quad.render();
+				pointsXY = pointTextureXY.readPixels(GL_RG);
+				pointsRGB = pointTextureRGB.readPixels(GL_RGB);
 
-			auto pointsXY = pointTextureXY.readPixels(GL_RG);
-			auto pointsRGB = pointTextureRGB.readPixels(GL_RGB);
+				metricsObserve(MetricsHistogram::RenderDuration, systemGetTimeNanoseconds() - renderStartTime);
+				metricsIncrement(MetricsCounter::RenderedBatches);
+				metricsIncrement(MetricsCounter::RenderedPoints, totalPointCount);
 
-			auto err = glGetError();
-			if (err != GL_NO_ERROR)
+				auto err = glGetError();
+				if (err != GL_NO_ERROR)
+				{
+					break;
+				}
+
+				if (!animated && commonParameters.verbose)
+				{
+					std::cout << "Shader uses no uniform, rendering once." << std::endl;
+				}
+				rendered = true;
+			}
+
+			// Resumes from the initial state of the stages, like the fallback did, e.g. with a blanked jump from the
+			// path stage instead of one continuing the batch streamed before the stall.
+			if (outputThread.getStallCount() != stallCount)
 			{
-				break;
+				stallCount = outputThread.getStallCount();
+				for (auto &pipeline : pipelines)
+				{
+					pipeline.reset();
+				}
+			}
+
+			// The repeated batch can only change with a new rendering, or a file reloaded by a stage, the pipelines
+			// being stateless: they are not run again until then.
+			if (repeating && !renderedNow && std::none_of(pipelines.begin(), pipelines.end(), [](const PointPipeline &pipeline)
+			{
+				return pipeline.hasPendingChange();
+			}))
+			{
+				pauseRepeating();
+				continue;
 			}
 
-			for (int pointIndex = 0; pointIndex < commonParameters.pointCount; ++pointIndex)
+			auto pipelineStartTime = systemGetTimeNanoseconds();
+
+			for (int dacIndex = 0; dacIndex < commonParameters.dacCount; ++dacIndex)
 			{
-				auto &point = points[pointIndex];
-				point.x = pointsXY[pointIndex * 2 + 0];
-				point.y = pointsXY[pointIndex * 2 + 1];
-				point.r = pointsRGB[pointIndex * 3 + 0];
-				point.g = pointsRGB[pointIndex * 3 + 1];
-				point.b = pointsRGB[pointIndex * 3 + 2];
+				auto &buffer = buffers[dacIndex];
+				auto dacPointsXY = pointsXY + dacIndex * commonParameters.pointCount * 2;
+				auto dacPointsRGB = pointsRGB + dacIndex * commonParameters.pointCount * 3;
+				buffer.unpack(dacPointsXY, dacPointsRGB, commonParameters.pointCount);
+
+				pipelines[dacIndex].process(buffer);
 			}
+			PointPipeline::equalizeCounts(buffers);
+
+			metricsObserve(MetricsHistogram::PipelineDuration, systemGetTimeNanoseconds() - pipelineStartTime);
+
+			auto stateless = std::all_of(pipelines.begin(), pipelines.end(), [](const PointPipeline &pipeline)
+			{
+				return pipeline.isStateless();
+			});
 
-			if (!output->streamPoints(points.get()))
+			if (!animated && stateless && !commonParameters.offline && output->canRepeatPoints())
+			{
+				uint64_t hash = 0;
+				for (auto &buffer : buffers)
+				{
+					hash = hash * 31 + buffer.hash();
+				}
+
+				if (!repeating || hash != repeatedHash)
+				{
+					if (!outputThread.push(buffers, true))
+					{
+						break;
+					}
+
+					if (!repeating)
+					{
+						repeatStartTime = systemGetTime();
+						repeatStartPointCount = emittedPointCount;
+					}
+
+					repeating = true;
+					repeatedHash = hash;
+				}
+
+				pauseRepeating();
+				continue;
+			}
+
+			repeating = false;
+
+			// Blocks while the output thread is behind.
+			auto pushStartTime = systemGetTimeNanoseconds();
+			if (!outputThread.push(buffers, false))
 			{
 				break;
 			}
+			metricsObserve(MetricsHistogram::PushWaitDuration, systemGetTimeNanoseconds() - pushStartTime);
+
+			emittedPointCount += buffers[0].count;
 
-			while (!output->needPoints())
+			if (checkAllocations && ++pushedBatchCount > AllocationWarmupBatchCount && (allocationGetThreadCount() != allocationCount || outputThread.hasAllocated()))
 			{
-				systemPause();
+				std::cerr << "Heap allocation in the streaming loop." << std::endl;
+				exitCode = ExitCode::SteadyStateAllocation;
+				break;
 			}
 		}
 		else
@@ -172,9 +720,31 @@ ExitCode run()
 		}
 	}
 
-	return ExitCode::Success;
+	outputThread.stop();
+	output->shutdown();
+
+	if (commonParameters.verbose || outputThreadSettings.priority > 0 || outputThreadSettings.cpu >= 0)
+	{
+		outputThread.printJitterReport(std::cout);
+	}
+
+	return exitCode;
 }
 
+#if defined(SYSTEM_LINUX)
+ExitCode runUdpReceiver(uint16_t port)
+{
+	UdpReceiver receiver{ commonParameters, pipelines, *output };
+	if (!receiver.open(port))
+	{
+		return ExitCode::InputFailed;
+	}
+
+	receiver.run();
+
+	return ExitCode::Success;
+}
+#endif
 
 int main(int argc, char **argv)
 {
@@ -186,23 +756,186 @@ int main(int argc, char **argv)
 		.defaultValue("1800")
 		.getValueAs<int>();
 
+	commonParameters.dacCount = parser.option("dac-count")
+		.alias("dc")
+		.description("Number of DACs fed by the same rendering.")
+		.defaultValue("1")
+		.getValueAs<int>();
+
 	commonParameters.pointsPerSecond = parser.option("points-per-second")
 		.alias("pps")
 		.description("Laser speed.")
 		.defaultValue("25000")
 		.getValueAs<uint16_t>();
 
+	auto inputClass = parser.option("input")
+		.alias("in")
+		.description("Point source, shader or udp.")
+		.defaultValue("shader")
+		.getValueAs<std::string>();
+
 	commonParameters.shaderPath = parser.option("shader")
 		.alias("s")
-		.description("Shader file path.")
-		.required()
+		.description("Shader file path, required with shader input.")
 		.getValueAs<std::string>();
 
+#if defined(SYSTEM_LINUX)
+	auto receivePort = parser.option("receive-port")
+		.alias("rp")
+		.description("UDP port to listen to with udp input.")
+		.defaultValue("7765")
+		.getValueAs<uint16_t>();
+#endif
+
+	commonParameters.offline = parser.flag("offline")
+		.alias("of")
+		.description("Advances time by the duration of the emitted points instead of the wall clock, and does not wait for the output.")
+		.getValue();
+
+	commonParameters.duration = parser.option("duration")
+		.alias("du")
+		.description("If greater than 0, stops after emitting this duration of points, in seconds.")
+		.defaultValue("0")
+		.getValueAs<float>();
+
 	commonParameters.verbose = parser.flag("verbose")
 		.alias("v")
 		.description("Shows information messages.")
 		.getValue();
 
+	auto offsetX = parser.option("offset-x")
+		.alias("ox")
+		.description("Offsets X coordinates.")
+		.defaultValue("0")
+		.getValueAs<float>();
+
+	auto offsetY = parser.option("offset-y")
+		.alias("oy")
+		.description("Offsets Y coordinates.")
+		.defaultValue("0")
+		.getValueAs<float>();
+
+	auto scale = parser.option("scale")
+		.alias("sc")
+		.description("Scales coordinates.")
+		.defaultValue("1")
+		.getValueAs<float>();
+
+	auto pipelineDescription = parser.option("pipeline")
+		.alias("pi")
+		.description("Point processing stages, e.g. \"rotate 90; gain 1 .8 .8\".")
+		.getValue();
+
+	auto pipelinePath = parser.option("pipeline-file")
+		.alias("pf")
+		.description("File listing point processing stages, applied before -pipeline.")
+		.getValue();
+
+	auto audioPath = parser.option("audio-path")
+		.alias("ap")
+		.description("WAV file whose frequency bands and onsets are given to the shader.")
+		.getValue();
+
+	audioOffset = parser.option("audio-offset")
+		.alias("ao")
+		.description("Seconds added to the emission time to look up the audio analysis.")
+		.defaultValue("0")
+		.getValueAs<float>();
+
+	auto uniformDescription = parser.option("uniforms")
+		.alias("un")
+		.description("User uniforms, e.g. \"speed 1.5; tint 1 0 0\".")
+		.getValue();
+
+	auto uniformPath = parser.option("uniform-file")
+		.alias("uf")
+		.description("File defining user uniforms, reloaded when it changes, applied after -uniforms.")
+		.getValue();
+
+#if defined(SYSTEM_LINUX)
+	auto uniformSocketPath = parser.option("uniform-socket")
+		.alias("us")
+		.description("Unix datagram socket path receiving user uniforms.")
+		.getValue();
+
+	auto metricsPort = parser.option("metrics-port")
+		.alias("mp")
+		.description("If greater than 0, serves metrics over HTTP on this loopback port.")
+		.defaultValue("0")
+		.getValueAs<int>();
+
+	auto metricsSocketPath = parser.option("metrics-socket")
+		.alias("ms")
+		.description("Unix stream socket path serving metrics over HTTP.")
+		.getValue();
+#endif
+
+	auto textureDescription = parser.option("textures")
+		.alias("tx")
+		.description("Data textures, e.g. \"noise noise.pfm; curve curve.pfm\".")
+		.getValue();
+
+	watchdogTimeout = parser.option("watchdog")
+		.alias("wd")
+		.description("If greater than 0, streams the fallback when no batch is rendered this many seconds after the previous one has played.")
+		.defaultValue("0")
+		.getValueAs<float>();
+
+	fallbackPattern = parser.option("fallback")
+		.alias("fb")
+		.description("Batch streamed by the watchdog, blank or idle.")
+		.defaultValue("blank")
+		.getValueAs<std::string>();
+
+	calibrationMode = parser.option("calibrate")
+		.alias("cal")
+		.description("Measures the shader at increasing batch sizes: report exits, auto then uses the smallest batch sustaining -pps.")
+		.getValueAs<std::string>();
+
+	auto hugePages = parser.flag("huge-pages")
+		.alias("hp")
+		.description("Allocates batch buffers on huge pages, if available.")
+		.getValue();
+
+	checkAllocations = parser.flag("check-allocations")
+		.alias("ca")
+		.description("Exits with an error if the streaming loop allocates memory, once warmed up.")
+		.getValue();
+
+	renderThreadSettings.cpu = parser.option("render-cpu")
+		.alias("rc")
+		.description("If not negative, pins the render thread to this CPU.")
+		.defaultValue("-1")
+		.getValueAs<int>();
+
+	outputThreadSettings.cpu = parser.option("output-cpu")
+		.alias("oc")
+		.description("If not negative, pins the output thread to this CPU.")
+		.defaultValue("-1")
+		.getValueAs<int>();
+
+	renderThreadSettings.priority = parser.option("render-priority")
+		.alias("rpr")
+		.description("If greater than 0, real-time priority of the render thread, up to 99.")
+		.defaultValue("0")
+		.getValueAs<int>();
+
+	outputThreadSettings.priority = parser.option("output-priority")
+		.alias("opr")
+		.description("If greater than 0, real-time priority of the output thread, up to 99.")
+		.defaultValue("0")
+		.getValueAs<int>();
+
+	renderThreadSettings.roundRobin = outputThreadSettings.roundRobin = parser.flag("round-robin")
+		.alias("rr")
+		.description("Uses round-robin real-time scheduling instead of FIFO.")
+		.getValue();
+
+	renderThreadSettings.lockMemory = outputThreadSettings.lockMemory = parser.flag("lock-memory")
+		.alias("lm")
+		.description("Locks memory pages and prefaults thread stacks, so that streaming does not page-fault.")
+		.getValue();
+
 	auto outputClass = parser.option("output")
 		.alias("o")
 		.description("Output implementation.")
@@ -217,6 +950,25 @@ int main(int argc, char **argv)
 	{
 		output.reset(new ConsoleOutput(commonParameters, parser));
 	}
+	else if (outputClass == "null")
+	{
+		output.reset(new NullOutput(commonParameters, parser));
+	}
+	else if (outputClass == "simulation")
+	{
+		output.reset(new BeamSimulationOutput(commonParameters, parser));
+	}
+
+#if defined(SYSTEM_LINUX)
+	else if (outputClass == "shm")
+	{
+		output.reset(new SharedMemoryOutput(commonParameters, parser));
+	}
+	else if (outputClass == "udp")
+	{
+		output.reset(new UdpOutput(commonParameters, parser));
+	}
+#endif
 
 #if defined(SYSTEM_WINDOWS)
 	else if (outputClass == "etherdream")
@@ -245,12 +997,201 @@ int main(int argc, char **argv)
 		return ExitCode::ParameterError;
 	}
 
+	if (commonParameters.pointCount <= 0 || commonParameters.dacCount <= 0)
+	{
+		std::cerr << "Point and DAC counts must be positive." << std::endl;
+		return ExitCode::ParameterError;
+	}
+
+	if (!calibrationMode.empty() && calibrationMode != "report" && calibrationMode != "auto")
+	{
+		std::cerr << "Unrecognized calibration." << std::endl;
+		return ExitCode::ParameterError;
+	}
+
+	if (fallbackPattern != "blank" && fallbackPattern != "idle")
+	{
+		std::cerr << "Unrecognized fallback." << std::endl;
+		return ExitCode::ParameterError;
+	}
+
+	if (inputClass == "shader")
+	{
+		if (commonParameters.shaderPath.empty())
+		{
+			std::cerr << "-shader required" << std::endl;
+			return ExitCode::ParameterError;
+		}
+	}
+#if defined(SYSTEM_LINUX)
+	else if (inputClass != "udp")
+#else
+	else
+#endif
+	{
+		std::cerr << "Unrecognized input." << std::endl;
+		return ExitCode::ParameterError;
+	}
+
+	auto layoutChanged = false;
+	if (uniformDescription && !uniformBlock.parse(uniformDescription, layoutChanged))
+	{
+		return ExitCode::ParameterError;
+	}
+
+	if (uniformPath)
+	{
+		uniformFilePath = uniformPath;
+
+		std::string uniformFileContent;
+		if (!readFile(uniformFilePath, uniformFileContent))
+		{
+			std::cerr << "Unable to open uniform file." << std::endl;
+			return ExitCode::ParameterError;
+		}
+
+		if (!uniformBlock.parse(uniformFileContent, layoutChanged))
+		{
+			return ExitCode::ParameterError;
+		}
+	}
+
+#if defined(SYSTEM_LINUX)
+	if (uniformSocketPath)
+	{
+		uniformSocket.reset(new UniformSocket{});
+		if (!uniformSocket->open(uniformSocketPath))
+		{
+			return ExitCode::ParameterError;
+		}
+	}
+
+	if (metricsPort > 0 || metricsSocketPath)
+	{
+		metricsServer.reset(new MetricsServer{});
+		if (!metricsServer->open(metricsPort, metricsSocketPath ? metricsSocketPath : ""))
+		{
+			return ExitCode::ParameterError;
+		}
+	}
+#endif
+
+	if (textureDescription && !loadDataTextures(textureDescription))
+	{
+		return ExitCode::ParameterError;
+	}
+
+	if (audioPath)
+	{
+		audioAnalysis.reset(new AudioAnalysis{});
+		if (!audioAnalysis->start(audioPath))
+		{
+			return ExitCode::ParameterError;
+		}
+
+		// Renderings only depend on the time.
+		if (commonParameters.offline)
+		{
+			audioAnalysis->finish();
+		}
+	}
+
+	batchArena.reset(new BatchArena{ hugePages });
+	commonParameters.arena = batchArena.get();
+
+	FileWatcher fileWatcher;
+
+	PointStageContext stageContext;
+	stageContext.pointsPerSecond = commonParameters.pointsPerSecond;
+
+	// The fallback is processed once before streaming, so its pipelines do not follow file changes.
+	auto buildPipeline = [&](PointPipeline &pipeline, FileWatcher *pipelineFileWatcher) -> bool
+	{
+		stageContext.fileWatcher = pipelineFileWatcher;
+
+		if (offsetX != 0.f || offsetY != 0.f)
+		{
+			pipeline.add(std::unique_ptr<PointStage>{ new AffineStage{ AffineStage::offset(offsetX, offsetY) } });
+		}
+
+		if (scale != 1.f)
+		{
+			pipeline.add(std::unique_ptr<PointStage>{ new AffineStage{ AffineStage::scale(scale, scale) } });
+		}
+
+		if (pipelinePath)
+		{
+			std::string pipelineFileContent;
+			if (!readFile(pipelinePath, pipelineFileContent))
+			{
+				std::cerr << "Unable to open pipeline file." << std::endl;
+				return false;
+			}
+
+			if (!pipeline.parse(pipelineFileContent, stageContext))
+			{
+				return false;
+			}
+		}
+
+		return !pipelineDescription || pipeline.parse(pipelineDescription, stageContext);
+	};
+
+	pipelines.resize(commonParameters.dacCount);
+	for (int dacIndex = 0; dacIndex < commonParameters.dacCount; ++dacIndex)
+	{
+		stageContext.dacIndex = dacIndex;
+		if (!buildPipeline(pipelines[dacIndex], &fileWatcher))
+		{
+			return ExitCode::ParameterError;
+		}
+	}
+
+	if (watchdogTimeout > 0.f)
+	{
+		fallbackPipelines.resize(commonParameters.dacCount);
+		for (int dacIndex = 0; dacIndex < commonParameters.dacCount; ++dacIndex)
+		{
+			stageContext.dacIndex = dacIndex;
+			if (!buildPipeline(fallbackPipelines[dacIndex], nullptr))
+			{
+				return ExitCode::ParameterError;
+			}
+		}
+	}
+
+	// Intermediate buffers may hold the points of any DAC once counts are equalized.
+	auto bufferCapacity = PointPipeline::getMaxCapacity(pipelines, commonParameters.pointCount);
+	for (auto &pipeline : pipelines)
+	{
+		pipeline.allocate(commonParameters.pointCount, *batchArena, bufferCapacity);
+	}
+	for (auto &pipeline : fallbackPipelines)
+	{
+		pipeline.allocate(commonParameters.pointCount, *batchArena, bufferCapacity);
+	}
+
+	commonParameters.maxPointCount = 0;
+	for (auto &pipeline : pipelines)
+	{
+		commonParameters.maxPointCount = std::max(commonParameters.maxPointCount, pipeline.getMaxOutputCount(commonParameters.pointCount));
+	}
+
 	auto status = output->initialize();
 	if (status != InitializationStatus::Success)
 	{
 		return ExitCode::OutputCreationFailed;
 	}
 
+#if defined(SYSTEM_LINUX)
+	if (inputClass == "udp")
+	{
+		fileWatcher.start();
+		systemStartTime();
+		return runUdpReceiver(receivePort);
+	}
+#endif
+
 	if (!contextCreate())
 	{
 		std::cerr << "Context creation failed." << std::endl;
@@ -270,12 +1211,19 @@ int main(int argc, char **argv)
 		return ExitCode::ExtensionsInitializationFailed;
 	}
 
-	FileWatcher fileWatcher;
-
-	fileWatcher.watchFile(commonParameters.shaderPath, [&]()
+	// The shader and its includes are watched once preprocessed.
+	shaderPreprocessor.reset(new ShaderPreprocessor{ &fileWatcher, [&]()
 	{
 		shaderChanged = true;
-	});
+	} });
+
+	if (!uniformFilePath.empty())
+	{
+		fileWatcher.watchFile(uniformFilePath, [&]()
+		{
+			uniformFileChanged = true;
+		});
+	}
 
 	fileWatcher.start();
 
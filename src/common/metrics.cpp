@@ -0,0 +1,195 @@
+#include "metrics.hpp"
+
+#include <atomic>
+#include <cstdio>
+
+// Threads beyond this count share an overflow shard, which is updated with atomic additions instead.
+static const int MaxShardCount = 16;
+
+// Upper bounds of the histogram buckets, in nanoseconds, doubling from 10 us. An additional bucket holds longer
+// durations.
+static const int64_t FirstBucketBound = 10000;
+static const int BucketCount = 16;
+
+static const int CounterCount = (int)MetricsCounter::_Count;
+static const int GaugeCount = (int)MetricsGauge::_Count;
+static const int HistogramCount = (int)MetricsHistogram::_Count;
+
+static const char *const MetricPrefix = "etherdream_glsl_";
+
+struct MetricDescription
+{
+	const char *name;
+	const char *help;
+};
+
+static const MetricDescription counterDescriptions[] = {
+	{ "rendered_batches_total", "Batches rendered by the shader." },
+	{ "rendered_points_total", "Points rendered by the shader, for all DACs." },
+	{ "streamed_batches_total", "Batches streamed to the output, including fallback ones." },
+	{ "streamed_points_total", "Points streamed to the output, for all DACs." },
+	{ "underruns_total", "Batches streamed too late after the previous one had played." },
+	{ "fallback_batches_total", "Batches streamed by the watchdog while rendering stalled." },
+	{ "shader_compilations_total", "Shader compilations, at startup and on reloads." },
+	{ "shader_compilation_failures_total", "Shader compilations which failed, the previous program being kept." },
+	{ "udp_dropped_packets_total", "Packets dropped on purpose by the UDP output." },
+	{ "udp_lost_batches_total", "Batches of which the UDP input received no packet." },
+	{ "udp_lost_packets_total", "Packets missing from the batches received by the UDP input." },
+};
+
+static const MetricDescription gaugeDescriptions[] = {
+	{ "output_filled_slots", "Batches waiting to be streamed by the output thread." },
+};
+
+static const MetricDescription histogramDescriptions[] = {
+	{ "render_duration_seconds", "Rendering and readback time per batch." },
+	{ "pipeline_duration_seconds", "Point pipeline time per batch, for all DACs." },
+	{ "push_wait_duration_seconds", "Time the render thread waited for a free output slot per batch." },
+	{ "stream_duration_seconds", "Time the output took to accept a batch." },
+	{ "shader_compilation_duration_seconds", "Shader preprocessing, compilation and linking time." },
+};
+
+static_assert(sizeof(counterDescriptions) / sizeof(counterDescriptions[0]) == CounterCount, "Missing counter description");
+static_assert(sizeof(gaugeDescriptions) / sizeof(gaugeDescriptions[0]) == GaugeCount, "Missing gauge description");
+static_assert(sizeof(histogramDescriptions) / sizeof(histogramDescriptions[0]) == HistogramCount, "Missing histogram description");
+
+// Aligned on cache lines, so that threads do not write to the same ones.
+struct alignas(64) Shard
+{
+	std::atomic<uint64_t> counters[CounterCount];
+	std::atomic<uint64_t> buckets[HistogramCount][BucketCount + 1];
+	std::atomic<uint64_t> sums[HistogramCount]; // In nanoseconds.
+};
+
+static Shard shards[MaxShardCount + 1];
+static std::atomic<int> usedShardCount{ 0 };
+
+static std::atomic<int64_t> gauges[GaugeCount];
+
+static thread_local Shard *threadShard = nullptr;
+static thread_local bool threadShardShared = false;
+
+static Shard &getShard()
+{
+	if (!threadShard)
+	{
+		auto index = usedShardCount.fetch_add(1, std::memory_order_relaxed);
+		threadShardShared = index >= MaxShardCount;
+		threadShard = &shards[threadShardShared ? MaxShardCount : index];
+	}
+	return *threadShard;
+}
+
+// Readers may see a value being updated, but never a torn one.
+static void add(std::atomic<uint64_t> &value, uint64_t increment)
+{
+	if (threadShardShared)
+	{
+		value.fetch_add(increment, std::memory_order_relaxed);
+	}
+	else
+	{
+		value.store(value.load(std::memory_order_relaxed) + increment, std::memory_order_relaxed);
+	}
+}
+
+void metricsIncrement(MetricsCounter counter, uint64_t value)
+{
+	add(getShard().counters[(int)counter], value);
+}
+
+void metricsSet(MetricsGauge gauge, int64_t value)
+{
+	gauges[(int)gauge].store(value, std::memory_order_relaxed);
+}
+
+void metricsObserve(MetricsHistogram histogram, int64_t duration)
+{
+	auto &shard = getShard();
+
+	int bucket = 0;
+	for (auto bound = FirstBucketBound; bucket < BucketCount && duration > bound; bound *= 2)
+	{
+		++bucket;
+	}
+
+	add(shard.buckets[(int)histogram][bucket], 1);
+	add(shard.sums[(int)histogram], (uint64_t)duration);
+}
+
+static void writeHeader(std::ostream &stream, const MetricDescription &description, const char *type)
+{
+	stream << "# HELP " << MetricPrefix << description.name << " " << description.help << "\n";
+	stream << "# TYPE " << MetricPrefix << description.name << " " << type << "\n";
+}
+
+// Exactly, unlike a double with the default stream precision.
+static void writeSeconds(std::ostream &stream, uint64_t nanoseconds)
+{
+	char text[32];
+	std::snprintf(text, sizeof(text), "%llu.%09llu", (unsigned long long)(nanoseconds / 1000000000), (unsigned long long)(nanoseconds % 1000000000));
+	stream << text;
+}
+
+void metricsWrite(std::ostream &stream)
+{
+	// Unused shards are zero.
+	for (int counter = 0; counter < CounterCount; ++counter)
+	{
+		auto &description = counterDescriptions[counter];
+		writeHeader(stream, description, "counter");
+
+		uint64_t value = 0;
+		for (auto &shard : shards)
+		{
+			value += shard.counters[counter].load(std::memory_order_relaxed);
+		}
+		stream << MetricPrefix << description.name << " " << value << "\n";
+	}
+
+	for (int gauge = 0; gauge < GaugeCount; ++gauge)
+	{
+		auto &description = gaugeDescriptions[gauge];
+		writeHeader(stream, description, "gauge");
+		stream << MetricPrefix << description.name << " " << gauges[gauge].load(std::memory_order_relaxed) << "\n";
+	}
+
+	for (int histogram = 0; histogram < HistogramCount; ++histogram)
+	{
+		auto &description = histogramDescriptions[histogram];
+		writeHeader(stream, description, "histogram");
+
+		// Buckets are cumulative.
+		uint64_t count = 0;
+		auto bound = FirstBucketBound;
+		for (int bucket = 0; bucket <= BucketCount; ++bucket, bound *= 2)
+		{
+			for (auto &shard : shards)
+			{
+				count += shard.buckets[histogram][bucket].load(std::memory_order_relaxed);
+			}
+
+			stream << MetricPrefix << description.name << "_bucket{le=\"";
+			if (bucket < BucketCount)
+			{
+				stream << bound * 1e-9;
+			}
+			else
+			{
+				stream << "+Inf";
+			}
+			stream << "\"} " << count << "\n";
+		}
+
+		uint64_t durationSum = 0;
+		for (auto &shard : shards)
+		{
+			durationSum += shard.sums[histogram].load(std::memory_order_relaxed);
+		}
+
+		stream << MetricPrefix << description.name << "_sum ";
+		writeSeconds(stream, durationSum);
+		stream << "\n";
+		stream << MetricPrefix << description.name << "_count " << count << "\n";
+	}
+}
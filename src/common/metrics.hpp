@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+// Counters, gauges and histograms of the streaming loop, exported in the Prometheus text format.
+//
+// Updates are lock-free and do not allocate, so that they can be made on the hot path: each thread writes to its
+// own shard of relaxed atomics, and shards are only summed when the metrics are read.
+
+enum class MetricsCounter
+{
+	RenderedBatches,
+	RenderedPoints,
+	StreamedBatches,
+	StreamedPoints, // All DACs.
+	Underruns,
+	FallbackBatches,
+	ShaderCompilations,
+	ShaderCompilationFailures,
+	UdpDroppedPackets,
+	UdpLostBatches,
+	UdpLostPackets,
+	_Count,
+};
+
+enum class MetricsGauge
+{
+	OutputFilledSlots,
+	_Count,
+};
+
+enum class MetricsHistogram
+{
+	RenderDuration,
+	PipelineDuration,
+	PushWaitDuration,
+	StreamDuration,
+	ShaderCompilationDuration,
+	_Count,
+};
+
+void metricsIncrement(MetricsCounter counter, uint64_t value = 1);
+
+void metricsSet(MetricsGauge gauge, int64_t value);
+
+// duration is in nanoseconds.
+void metricsObserve(MetricsHistogram histogram, int64_t duration);
+
+// Writes the sums of all shards, from any thread.
+void metricsWrite(std::ostream &stream);
@@ -1,8 +1,10 @@
 #include "opengl.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <iterator>
 
+#include "BatchArena.hpp"
 #include "system.hpp"
 
 GLuint ObjectWithName::getName() const
@@ -20,7 +22,7 @@ Shader::~Shader()
 	glDeleteShader(name);
 }
 
-bool Shader::compile(const std::string &source)
+bool Shader::compile(const std::string &source, const std::function<std::string(const std::string &)> &translateLog)
 {
 	auto cSource = (const GLchar *)source.c_str();
 	glShaderSource(name, 1, &cSource, 0);
@@ -37,7 +39,14 @@ bool Shader::compile(const std::string &source)
 		std::vector<GLchar> infoLog(maxLength);
 		glGetShaderInfoLog(name, maxLength, &maxLength, &infoLog[0]);
 
-		std::copy(infoLog.begin(), infoLog.end(), std::ostream_iterator<char>(std::cerr));
+		if (translateLog)
+		{
+			std::cerr << translateLog(std::string{ infoLog.data(), (std::size_t)std::max(maxLength, 0) });
+		}
+		else
+		{
+			std::copy(infoLog.begin(), infoLog.end(), std::ostream_iterator<char>(std::cerr));
+		}
 
 		return false;
 	}
@@ -88,6 +97,8 @@ bool Program::link()
 
 	uniformLocations[Uniform::Base] = glGetUniformLocation(name, "base");
 	uniformLocations[Uniform::Time] = glGetUniformLocation(name, "time");
+	uniformLocations[Uniform::AudioBands] = glGetUniformLocation(name, "audioBands");
+	uniformLocations[Uniform::AudioOnset] = glGetUniformLocation(name, "audioOnset");
 
 	return true;
 }
@@ -97,18 +108,53 @@ bool Program::isLinked() const
 	return linked;
 }
 
+bool Program::isAnimated() const
+{
+	// Uniforms optimized out by the linker have no location, e.g. base when the fragment shader does not read index.
+	// Dropping unused uniforms is not required by the GL specification: an implementation keeping them only makes
+	// the program rendered for every batch, a used uniform always having a location.
+	return std::any_of(uniformLocations.begin(), uniformLocations.end(), [](GLuint location)
+	{
+		return (GLint)location != -1;
+	});
+}
+
 void Program::incrementBase(int pointCount)
 {
 	glUniform1f(uniformLocations[Uniform::Base], (float)base);
 	base += pointCount;
 }
 
-void Program::updateTime()
+void Program::setTime(float time)
+{
+	glUniform1f(uniformLocations[Uniform::Time], time);
+}
+
+void Program::setAudio(const float *bands, int bandCount, float onset)
+{
+	glUniform1fv(uniformLocations[Uniform::AudioBands], bandCount, bands);
+	glUniform1f(uniformLocations[Uniform::AudioOnset], onset);
+}
+
+void Program::bindUniformBlock(const char *blockName, GLuint bindingIndex)
+{
+	auto blockIndex = glGetUniformBlockIndex(name, blockName);
+	if (blockIndex != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(name, blockIndex, bindingIndex);
+	}
+}
+
+void Program::setSampler(const std::string &samplerName, int unit)
 {
-	glUniform1f(uniformLocations[Uniform::Time], systemGetTime());
+	auto location = glGetUniformLocation(name, samplerName.c_str());
+	if (location != -1)
+	{
+		glUniform1i(location, unit);
+	}
 }
 
-PointTexture::PointTexture(int components, GLint internalFormat, int pointCount)
+PointTexture::PointTexture(int components, GLint internalFormat, int pointCount, BatchArena &arena)
 {
 	glGenTextures(1, &name);
 	glBindTexture(GL_TEXTURE_1D, name);
@@ -118,7 +164,7 @@ PointTexture::PointTexture(int components, GLint internalFormat, int pointCount)
 	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 
-	pixels.reset(new float[components * pointCount]);
+	pixels = arena.allocate<float>((std::size_t)components * pointCount);
 }
 
 PointTexture::~PointTexture()
@@ -129,8 +175,62 @@ PointTexture::~PointTexture()
 float *PointTexture::readPixels(GLenum format)
 {
 	glBindTexture(GL_TEXTURE_1D, name);
-	glGetTexImage(GL_TEXTURE_1D, 0, format, GL_FLOAT, pixels.get());
-	return pixels.get();
+	glGetTexImage(GL_TEXTURE_1D, 0, format, GL_FLOAT, pixels);
+	return pixels;
+}
+
+DataTexture::DataTexture(int components, int width, int height, const float *data)
+{
+	static const GLint internalFormats[] = { GL_R32F, GL_RG32F, GL_RGB32F, GL_RGBA32F };
+	static const GLenum formats[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+
+	glGenTextures(1, &name);
+	glBindTexture(GL_TEXTURE_2D, name);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormats[components - 1], width, height, 0, formats[components - 1], GL_FLOAT, data);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+DataTexture::~DataTexture()
+{
+	glDeleteTextures(1, &name);
+}
+
+void DataTexture::bind(int unit) const
+{
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_2D, name);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+UniformBuffer::UniformBuffer(GLuint bindingIndex)
+{
+	glGenBuffers(1, &name);
+	glBindBufferBase(GL_UNIFORM_BUFFER, bindingIndex, name);
+}
+
+UniformBuffer::~UniformBuffer()
+{
+	glDeleteBuffers(1, &name);
+}
+
+void UniformBuffer::update(const void *data, int size)
+{
+	glBindBuffer(GL_UNIFORM_BUFFER, name);
+	if (size != this->size)
+	{
+		glBufferData(GL_UNIFORM_BUFFER, size, data, GL_DYNAMIC_DRAW);
+		this->size = size;
+	}
+	else
+	{
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+	}
 }
 
 Framebuffer::Framebuffer(std::initializer_list<std::reference_wrapper<PointTexture>> list)
@@ -183,6 +283,24 @@ bool Framebuffer::isComplete() const
 	return (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
 }
 
+std::string Quad::getVertexSource(int pointCount)
+{
+	return "#version 330\n\
+		layout(location = 0) in vec2 aPosition;\n\
+		layout(location = 1) in float aOffset;\n\
+		out float index;\n\
+		out float dac;\n\
+		out float pointIndex;\n\
+		uniform float base;\n\
+		const float pointCount = " + std::to_string(pointCount) + ".;\n\
+		void main() {\n\
+			gl_Position = vec4(aPosition, 0, 1);\n\
+			index = base + aOffset;\n\
+			dac = (aOffset + .5) / pointCount;\n\
+			pointIndex = aOffset - floor(dac) * pointCount;\n\
+		}";
+}
+
 Quad::Quad(int pointCount)
 {
 	const GLfloat positions[4][2] = {
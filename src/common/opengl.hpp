@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -12,6 +13,8 @@
 #include <GL/gl.h>
 #endif
 
+class BatchArena;
+
 class ObjectWithName
 {
 public:
@@ -27,7 +30,8 @@ public:
 	Shader(GLenum shaderType);
 	~Shader();
 
-	bool compile(const std::string &source);
+	// translateLog may rewrite the compilation log before it is shown.
+	bool compile(const std::string &source, const std::function<std::string(const std::string &)> &translateLog = nullptr);
 };
 
 class Program : public ObjectWithName
@@ -37,6 +41,8 @@ public:
 	{
 		Base,
 		Time,
+		AudioBands,
+		AudioOnset,
 		_Count,
 	};
 
@@ -46,8 +52,18 @@ public:
 	bool link();
 	bool isLinked() const;
 
+	// Whether the output may change between renderings, i.e. base, time or audio uniforms are used.
+	bool isAnimated() const;
+
 	void incrementBase(int pointCount);
-	void updateTime();
+	void setTime(float time);
+	void setAudio(const float *bands, int bandCount, float onset);
+
+	// Binds the uniform block to a buffer binding point, if the program uses it.
+	void bindUniformBlock(const char *blockName, GLuint bindingIndex);
+
+	// Binds the sampler to a texture unit, if the program uses it.
+	void setSampler(const std::string &samplerName, int unit);
 
 private:
 	GLuint vertexShaderName{ 0 };
@@ -62,13 +78,36 @@ private:
 class PointTexture : public ObjectWithName
 {
 public:
-	PointTexture(int components, GLint internalFormat, int pointCount);
+	// pixels are taken from the arena.
+	PointTexture(int components, GLint internalFormat, int pointCount, BatchArena &arena);
 	~PointTexture();
 
 	float *readPixels(GLenum);
 
 private:
-	std::unique_ptr<float[]> pixels;
+	float *pixels;
+};
+
+// 2D float texture of user data, sampled linearly.
+class DataTexture : public ObjectWithName
+{
+public:
+	DataTexture(int components, int width, int height, const float *data);
+	~DataTexture();
+
+	void bind(int unit) const;
+};
+
+class UniformBuffer : public ObjectWithName
+{
+public:
+	UniformBuffer(GLuint bindingIndex);
+	~UniformBuffer();
+
+	void update(const void *data, int size);
+
+private:
+	int size{ 0 };
 };
 
 class Framebuffer : public ObjectWithName
@@ -92,6 +131,9 @@ public:
 		Offset,
 	};
 
+	// Vertex shader giving the index, dac and pointIndex varyings, for DACs of pointCount points each.
+	static std::string getVertexSource(int pointCount);
+
 	Quad(int pointCount);
 	~Quad();
 
@@ -0,0 +1,7 @@
+#pragma once
+
+// SSE2 is available on every x64 target, and on x86 ones when enabled. Code using it must keep a scalar path.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE2
+#include <emmintrin.h>
+#endif
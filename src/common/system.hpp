@@ -1,12 +1,41 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <tuple>
 
 void systemStartTime();
 
-float systemGetTime();
+// Seconds since systemStartTime(), from a monotonic clock.
+double systemGetTime();
+
+// Nanoseconds since systemStartTime(), from a monotonic clock.
+int64_t systemGetTimeNanoseconds();
 
 std::tuple<std::string, std::string> systemSplitDirectoryNameAndBaseName(const std::string &path);
 
+// Sleeps for the given duration in seconds, or yields if 0.
 void systemPause(float duration = 0.f);
+
+// Returns at the given time from systemGetTimeNanoseconds(), sleeping then spinning for the last part, since
+// sleeps wake up late.
+void systemWaitUntil(int64_t deadline);
+
+// The following return false if not permitted or not supported, in which case nothing changes.
+
+// Pins the calling thread to a CPU.
+bool systemSetThreadAffinity(int cpu);
+
+// Gives the calling thread a real-time priority, from 1 to 99, with FIFO or round-robin scheduling.
+bool systemSetThreadRealTimePriority(int priority, bool roundRobin);
+
+// Locks current and future pages of the process in memory, faulting them in.
+bool systemLockMemory();
+
+// Allocates zeroed whole pages, returns nullptr on failure. If hugePages is true, tries huge pages first, and
+// tells whether they were used. size must be a multiple of 2 MB for huge pages.
+void *systemAllocatePages(std::size_t size, bool &hugePages);
+
+// Arguments are those given to and returned by systemAllocatePages().
+void systemFreePages(void *address, std::size_t size, bool hugePages);
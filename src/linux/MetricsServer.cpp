@@ -0,0 +1,237 @@
+#include "MetricsServer.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sstream>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../common/metrics.hpp"
+#include "socket.hpp"
+
+MetricsServer::~MetricsServer()
+{
+	if (thread.joinable())
+	{
+		uint64_t value = 1;
+		if (write(stopDescriptor, &value, sizeof(value)) == sizeof(value))
+		{
+			thread.join();
+		}
+		else
+		{
+			thread.detach();
+		}
+	}
+
+	for (auto descriptor : listenDescriptors)
+	{
+		close(descriptor);
+	}
+
+	if (stopDescriptor >= 0)
+	{
+		close(stopDescriptor);
+	}
+
+	if (!path.empty())
+	{
+		socketRemove(path);
+	}
+}
+
+bool MetricsServer::open(int port, const std::string &path)
+{
+	if (port > 0 && !listenOnPort(port))
+	{
+		return false;
+	}
+
+	if (!path.empty() && !listenOnPath(path))
+	{
+		return false;
+	}
+
+	stopDescriptor = eventfd(0, EFD_CLOEXEC);
+	if (stopDescriptor < 0)
+	{
+		std::cerr << "Cannot create metrics server event: " << std::strerror(errno) << "." << std::endl;
+		return false;
+	}
+
+	thread = std::thread{ &MetricsServer::run, this };
+	return true;
+}
+
+bool MetricsServer::listenOnPort(int port)
+{
+	auto descriptor = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (descriptor < 0)
+	{
+		std::cerr << "Cannot create metrics socket: " << std::strerror(errno) << "." << std::endl;
+		return false;
+	}
+
+	int reuse = 1;
+	setsockopt(descriptor, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+	// Loopback only, metrics are not meant to be exposed to the network.
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_port = htons((uint16_t)port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if (bind(descriptor, (sockaddr *)&address, sizeof(address)) < 0 || listen(descriptor, 4) < 0)
+	{
+		std::cerr << "Cannot listen on metrics port: " << std::strerror(errno) << "." << std::endl;
+		close(descriptor);
+		return false;
+	}
+
+	listenDescriptors.push_back(descriptor);
+	return true;
+}
+
+bool MetricsServer::listenOnPath(const std::string &path)
+{
+	sockaddr_un address{};
+	if (path.size() >= sizeof(address.sun_path))
+	{
+		std::cerr << "Metrics socket path is too long." << std::endl;
+		return false;
+	}
+
+	auto descriptor = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (descriptor < 0)
+	{
+		std::cerr << "Cannot create metrics socket: " << std::strerror(errno) << "." << std::endl;
+		return false;
+	}
+
+	address.sun_family = AF_UNIX;
+	std::strcpy(address.sun_path, path.c_str());
+
+	if (!socketRemove(path))
+	{
+		std::cerr << "Metrics socket path is taken by a file which is not a socket." << std::endl;
+		close(descriptor);
+		return false;
+	}
+
+	if (bind(descriptor, (sockaddr *)&address, sizeof(address)) < 0 || listen(descriptor, 4) < 0)
+	{
+		std::cerr << "Cannot listen on metrics socket: " << std::strerror(errno) << "." << std::endl;
+		close(descriptor);
+		return false;
+	}
+
+	this->path = path;
+	listenDescriptors.push_back(descriptor);
+	return true;
+}
+
+void MetricsServer::run()
+{
+	std::vector<pollfd> descriptors;
+	for (auto descriptor : listenDescriptors)
+	{
+		descriptors.push_back({ descriptor, POLLIN, 0 });
+	}
+	descriptors.push_back({ stopDescriptor, POLLIN, 0 });
+
+	for (;;)
+	{
+		if (poll(descriptors.data(), descriptors.size(), -1) < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return;
+		}
+
+		if (descriptors.back().revents)
+		{
+			return;
+		}
+
+		for (std::size_t index = 0; index + 1 < descriptors.size(); ++index)
+		{
+			if (!(descriptors[index].revents & POLLIN))
+			{
+				continue;
+			}
+
+			auto connectionDescriptor = accept4(descriptors[index].fd, nullptr, nullptr, SOCK_CLOEXEC);
+			if (connectionDescriptor >= 0)
+			{
+				serve(connectionDescriptor);
+				close(connectionDescriptor);
+			}
+		}
+	}
+}
+
+void MetricsServer::serve(int connectionDescriptor)
+{
+	// A slow client must not block the server, nor its stop.
+	timeval timeout{};
+	timeout.tv_sec = ConnectionTimeout / 1000;
+	timeout.tv_usec = ConnectionTimeout % 1000 * 1000;
+	setsockopt(connectionDescriptor, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	setsockopt(connectionDescriptor, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+	// Only the request line matters, headers are read until the blank line so that the client sees a clean close.
+	std::string request;
+	char buffer[1024];
+	while (request.find("\r\n\r\n") == std::string::npos && request.size() < MaxRequestSize)
+	{
+		auto size = recv(connectionDescriptor, buffer, sizeof(buffer), 0);
+		if (size <= 0)
+		{
+			return;
+		}
+		request.append(buffer, (std::size_t)size);
+	}
+
+	std::ostringstream response;
+	if (request.compare(0, 4, "GET ") == 0)
+	{
+		std::ostringstream body;
+		metricsWrite(body);
+		auto text = body.str();
+
+		response << "HTTP/1.0 200 OK\r\n"
+			<< "Content-Type: text/plain; version=0.0.4\r\n"
+			<< "Content-Length: " << text.size() << "\r\n"
+			<< "\r\n"
+			<< text;
+	}
+	else
+	{
+		response << "HTTP/1.0 405 Method Not Allowed\r\n"
+			<< "Content-Length: 0\r\n"
+			<< "\r\n";
+	}
+
+	auto text = response.str();
+	std::size_t sentSize = 0;
+	while (sentSize < text.size())
+	{
+		auto size = send(connectionDescriptor, text.data() + sentSize, text.size() - sentSize, MSG_NOSIGNAL);
+		if (size < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return;
+		}
+		sentSize += (std::size_t)size;
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <thread>
+#include <vector>
+
+// Serves the metrics in the Prometheus text format over HTTP, from its own thread, so that a running instance can
+// be monitored, e.g. with curl http://127.0.0.1:9100/metrics. Listens on the loopback interface and/or on a Unix
+// stream socket, which can be restricted by file permissions.
+//
+// Requests are served one at a time, any GET path returning the metrics.
+class MetricsServer
+{
+public:
+	~MetricsServer();
+
+	// Listens on the TCP port, unless 0, and on the socket path, unless empty, then starts the thread.
+	bool open(int port, const std::string &path);
+
+private:
+	static const int MaxRequestSize = 8192;
+	static const int ConnectionTimeout = 1000; // In milliseconds.
+
+	std::string path;
+	std::vector<int> listenDescriptors;
+	int stopDescriptor{ -1 };
+	std::thread thread;
+
+	bool listenOnPort(int port);
+	bool listenOnPath(const std::string &path);
+	void run();
+	void serve(int connectionDescriptor);
+};
@@ -0,0 +1,145 @@
+#include "SharedMemoryOutput.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "../common/system.hpp"
+
+SharedMemoryOutput::SharedMemoryOutput(const CommonParameters &commonParameters, cli::Parser &parser)
+	: Output{ commonParameters }
+{
+	name = parser.option("shm-name")
+		.alias("n")
+		.description("Shared memory object name, i.e. /dev/shm file name with a leading slash.")
+		.defaultValue("/etherdream-glsl")
+		.getValueAs<std::string>();
+
+	slotCount = parser.option("slot-count")
+		.alias("c")
+		.description("Number of batches kept in the ring.")
+		.defaultValue("16")
+		.getValueAs<int>();
+}
+
+SharedMemoryOutput::~SharedMemoryOutput()
+{
+	shutdown();
+}
+
+InitializationStatus SharedMemoryOutput::initialize()
+{
+	if (slotCount <= 0)
+	{
+		std::cerr << "Slot count must be positive." << std::endl;
+		return InitializationStatus::Failure;
+	}
+
+	auto slotSize = SharedMemoryRing::getSlotSize(commonParameters.dacCount, commonParameters.maxPointCount);
+	mappingSize = SharedMemoryRing::getHeaderSize() + slotSize * slotCount;
+
+	// The object of a previous run is unlinked rather than truncated, so that its readers keep their mapping instead
+	// of getting SIGBUS or a torn ring. The new object is zero-filled, so slot sequences start at zero.
+	shm_unlink(name.c_str());
+
+	auto fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	if (fd < 0)
+	{
+		std::cerr << "Cannot open shared memory " << name << ": " << std::strerror(errno) << "." << std::endl;
+		return InitializationStatus::Failure;
+	}
+
+	if (ftruncate(fd, (off_t)mappingSize) < 0)
+	{
+		std::cerr << "Cannot resize shared memory: " << std::strerror(errno) << "." << std::endl;
+		close(fd);
+		shm_unlink(name.c_str());
+		return InitializationStatus::Failure;
+	}
+
+	auto address = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (address == MAP_FAILED)
+	{
+		std::cerr << "Cannot map shared memory: " << std::strerror(errno) << "." << std::endl;
+		return InitializationStatus::Failure;
+	}
+
+	header = new (address) SharedMemoryRing::Header;
+	header->version = SharedMemoryRing::Version;
+	header->slotCount = (uint32_t)slotCount;
+	header->slotSize = (uint32_t)slotSize;
+	header->dacCount = (uint32_t)commonParameters.dacCount;
+	header->maxPointCount = (uint32_t)commonParameters.maxPointCount;
+	header->pointsPerSecond = commonParameters.pointsPerSecond;
+	header->writeSequence.store(0, std::memory_order_relaxed);
+
+	for (int index = 0; index < slotCount; ++index)
+	{
+		auto slot = new (SharedMemoryRing::getSlot(header, index)) SharedMemoryRing::SlotHeader;
+		slot->sequence.store(0, std::memory_order_relaxed);
+	}
+
+	// Readers check the magic last.
+	std::atomic_thread_fence(std::memory_order_release);
+	header->magic = SharedMemoryRing::Magic;
+
+	if (commonParameters.verbose)
+	{
+		std::cout << "Publishing to /dev/shm" << name << " (" << mappingSize << " bytes)." << std::endl;
+	}
+
+	return InitializationStatus::Success;
+}
+
+void SharedMemoryOutput::shutdown()
+{
+	if (header)
+	{
+		munmap(header, mappingSize);
+		shm_unlink(name.c_str());
+		header = nullptr;
+	}
+}
+
+bool SharedMemoryOutput::needPoints()
+{
+	return isNextBatchDue();
+}
+
+bool SharedMemoryOutput::streamPoints(const PointBuffer *buffers)
+{
+	auto time = systemGetTime();
+
+	auto sequence = header->writeSequence.load(std::memory_order_relaxed);
+	auto slot = SharedMemoryRing::getSlot(header, sequence);
+
+	slot->sequence.store(2 * sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	auto counts = SharedMemoryRing::getCounts(slot);
+	for (int dacIndex = 0; dacIndex < commonParameters.dacCount; ++dacIndex)
+	{
+		auto &buffer = buffers[dacIndex];
+		counts[dacIndex] = (uint32_t)buffer.count;
+
+		const float *channels[SharedMemoryRing::ChannelCount] = { buffer.x, buffer.y, buffer.r, buffer.g, buffer.b };
+		for (int channel = 0; channel < SharedMemoryRing::ChannelCount; ++channel)
+		{
+			std::memcpy(SharedMemoryRing::getChannel(header, slot, dacIndex, channel), channels[channel], sizeof(float) * buffer.count);
+		}
+	}
+	slot->time = time;
+
+	slot->sequence.store(2 * (sequence + 1), std::memory_order_release);
+	header->writeSequence.store(sequence + 1, std::memory_order_release);
+
+	scheduleNextBatch(buffers[0].count);
+
+	return true;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cli.hpp>
+#include <string>
+
+#include "../common/Output.hpp"
+#include "SharedMemoryRing.hpp"
+
+// Publishes batches into a ring in POSIX shared memory, see SharedMemoryRing.hpp for the layout.
+class SharedMemoryOutput : public Output
+{
+public:
+	SharedMemoryOutput(const CommonParameters &commonParameters, cli::Parser &parser);
+	~SharedMemoryOutput();
+
+	InitializationStatus initialize() override;
+	void shutdown() override;
+
+	bool needPoints() override;
+	bool streamPoints(const PointBuffer *buffers) override;
+
+private:
+	std::string name;
+	int slotCount;
+
+	SharedMemoryRing::Header *header{ nullptr };
+	std::size_t mappingSize{ 0 };
+};
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "../common/PointBuffer.hpp"
+
+// Layout of the shared memory published by SharedMemoryOutput, to be included by external readers.
+//
+// The memory starts with a Header, followed by slotCount slots of slotSize bytes. Each slot starts with a
+// SlotHeader, followed by the point count of each DAC, then for each DAC the channels x, y, r, g and b, each
+// made of maxPointCount floats. Batch n is written in slot n % slotCount.
+//
+// There is a single writer which never waits for readers. Each slot is protected by a sequence lock: a reader
+// checks the slot sequence before and after reading the points, and discards the batch if they differ.
+//
+// Each run creates a new object under the name. Readers of a previous run keep their mapping, which is no longer
+// written, and must open the name again to follow the new run.
+namespace SharedMemoryRing
+{
+	static const uint32_t Magic = 0x50474445; // "EDGP"
+	static const uint32_t Version = 2;
+
+	static const std::size_t Alignment = 64;
+	static const int ChannelCount = 5;
+
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t slotCount;
+		uint32_t slotSize; // In bytes, including the slot header.
+		uint32_t dacCount;
+		uint32_t maxPointCount; // Per DAC.
+		uint32_t pointsPerSecond;
+		uint32_t reserved;
+
+		// Sequence of the next batch to be written.
+		std::atomic<uint64_t> writeSequence;
+	};
+
+	struct SlotHeader
+	{
+		// Odd while batch (sequence - 1) / 2 is being written, 2 * (n + 1) once batch n is complete.
+		std::atomic<uint64_t> sequence;
+		double time; // Seconds since start.
+	};
+
+	enum class ReadStatus
+	{
+		Success,
+		NotWrittenYet,
+		Overrun,
+	};
+
+	inline std::size_t align(std::size_t size)
+	{
+		return (size + Alignment - 1) & ~(Alignment - 1);
+	}
+
+	inline std::size_t getHeaderSize()
+	{
+		return align(sizeof(Header));
+	}
+
+	inline std::size_t getChannelSize(std::size_t maxPointCount)
+	{
+		return align(sizeof(float) * maxPointCount);
+	}
+
+	inline std::size_t getSlotSize(std::size_t dacCount, std::size_t maxPointCount)
+	{
+		return align(sizeof(SlotHeader)) + align(sizeof(uint32_t) * dacCount) + getChannelSize(maxPointCount) * ChannelCount * dacCount;
+	}
+
+	inline SlotHeader *getSlot(const Header *header, uint64_t sequence)
+	{
+		auto base = (char *)header + getHeaderSize();
+		return (SlotHeader *)(base + (std::size_t)(sequence % header->slotCount) * header->slotSize);
+	}
+
+	inline uint32_t *getCounts(SlotHeader *slot)
+	{
+		return (uint32_t *)((char *)slot + align(sizeof(SlotHeader)));
+	}
+
+	// Channels are 0 for x, 1 for y, 2 for r, 3 for g and 4 for b.
+	inline float *getChannel(const Header *header, SlotHeader *slot, int dacIndex, int channel)
+	{
+		auto channels = (char *)getCounts(slot) + align(sizeof(uint32_t) * header->dacCount);
+		auto channelSize = getChannelSize(header->maxPointCount);
+		return (float *)(channels + channelSize * ((std::size_t)dacIndex * ChannelCount + channel));
+	}
+
+	// Copies batch sequence into destinations, one per DAC, whose capacities are at least maxPointCount.
+	// On Overrun, the reader is too late and should resume from writeSequence - 1.
+	inline ReadStatus read(const Header *header, uint64_t sequence, PointBuffer *destinations, double *time = nullptr)
+	{
+		auto writeSequence = header->writeSequence.load(std::memory_order_acquire);
+		if (sequence >= writeSequence)
+		{
+			return ReadStatus::NotWrittenYet;
+		}
+		if (writeSequence - sequence > header->slotCount)
+		{
+			return ReadStatus::Overrun;
+		}
+
+		auto slot = getSlot(header, sequence);
+		auto expected = 2 * (sequence + 1);
+
+		if (slot->sequence.load(std::memory_order_acquire) != expected)
+		{
+			return ReadStatus::Overrun;
+		}
+
+		auto counts = getCounts(slot);
+		for (int dacIndex = 0; dacIndex < (int)header->dacCount; ++dacIndex)
+		{
+			auto &destination = destinations[dacIndex];
+			destination.count = (int)std::min(counts[dacIndex], header->maxPointCount);
+
+			float *destinationChannels[ChannelCount] = { destination.x, destination.y, destination.r, destination.g, destination.b };
+			for (int channel = 0; channel < ChannelCount; ++channel)
+			{
+				auto source = getChannel(header, slot, dacIndex, channel);
+				std::copy(source, source + destination.count, destinationChannels[channel]);
+			}
+		}
+		auto slotTime = slot->time;
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot->sequence.load(std::memory_order_relaxed) != expected)
+		{
+			return ReadStatus::Overrun;
+		}
+
+		if (time)
+		{
+			*time = slotTime;
+		}
+		return ReadStatus::Success;
+	}
+}
@@ -0,0 +1,182 @@
+#include "UdpOutput.hpp"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <unistd.h>
+
+#include "../common/metrics.hpp"
+
+UdpOutput::UdpOutput(const CommonParameters &commonParameters, cli::Parser &parser)
+	: Output{ commonParameters }
+{
+	address = parser.option("address")
+		.alias("a")
+		.description("Receiver IPv4 address.")
+		.defaultValue("127.0.0.1")
+		.getValueAs<std::string>();
+
+	port = parser.option("port")
+		.alias("po")
+		.description("Receiver UDP port.")
+		.defaultValue("7765")
+		.getValueAs<uint16_t>();
+
+	packetSize = parser.option("packet-size")
+		.alias("ps")
+		.description("Maximum UDP payload size, in bytes.")
+		.defaultValue("1200")
+		.getValueAs<int>();
+
+	color16 = parser.option("color-depth")
+		.alias("cd")
+		.description("Bits per color channel, 8 or 16.")
+		.defaultValue("8")
+		.getValueAs<int>() == 16;
+
+	deltaPositions = parser.flag("delta")
+		.alias("dl")
+		.description("Encodes positions as deltas from the previous point when they are small enough.")
+		.getValue();
+
+	dropRate = parser.option("drop-rate")
+		.alias("dr")
+		.description("Probability of dropping a packet, to test loss handling.")
+		.defaultValue("0")
+		.getValueAs<float>();
+}
+
+UdpOutput::~UdpOutput()
+{
+	shutdown();
+}
+
+InitializationStatus UdpOutput::initialize()
+{
+	if (packetSize < 64 || packetSize > 65507)
+	{
+		std::cerr << "Packet size must be in range [64, 65507]." << std::endl;
+		return InitializationStatus::Failure;
+	}
+
+	if (commonParameters.maxPointCount > UINT16_MAX || commonParameters.dacCount > UINT16_MAX)
+	{
+		std::cerr << "Too many points for the wire format." << std::endl;
+		return InitializationStatus::Failure;
+	}
+
+	sockaddr_in destination{};
+	destination.sin_family = AF_INET;
+	destination.sin_port = htons(port);
+	if (inet_pton(AF_INET, address.c_str(), &destination.sin_addr) != 1)
+	{
+		std::cerr << "Invalid address." << std::endl;
+		return InitializationStatus::Failure;
+	}
+
+	socketDescriptor = socket(AF_INET, SOCK_DGRAM, 0);
+	if (socketDescriptor < 0)
+	{
+		std::cerr << "Cannot create socket: " << std::strerror(errno) << "." << std::endl;
+		return InitializationStatus::Failure;
+	}
+
+	// Connecting allows sendmmsg without per-message addresses.
+	if (connect(socketDescriptor, (sockaddr *)&destination, sizeof(destination)) < 0)
+	{
+		std::cerr << "Cannot connect socket: " << std::strerror(errno) << "." << std::endl;
+		shutdown();
+		return InitializationStatus::Failure;
+	}
+
+	encoder.reset(new PointStreamCodec::Encoder{ packetSize, color16, deltaPositions });
+
+	auto maxPacketCount = encoder->getMaxPacketCount(commonParameters.maxPointCount) * commonParameters.dacCount;
+	encoder->reserve(maxPacketCount);
+	messages.resize(maxPacketCount);
+	vectors.resize(maxPacketCount);
+
+	dropDistribution = std::uniform_real_distribution<float>{ 0.f, 1.f };
+
+	if (commonParameters.verbose)
+	{
+		std::cout << "Sending to " << address << ":" << port << "." << std::endl;
+	}
+
+	return InitializationStatus::Success;
+}
+
+void UdpOutput::shutdown()
+{
+	if (socketDescriptor >= 0)
+	{
+		close(socketDescriptor);
+		socketDescriptor = -1;
+	}
+}
+
+bool UdpOutput::needPoints()
+{
+	return isNextBatchDue();
+}
+
+bool UdpOutput::streamPoints(const PointBuffer *buffers)
+{
+	encoder->clear();
+	for (int dacIndex = 0; dacIndex < commonParameters.dacCount; ++dacIndex)
+	{
+		encoder->encode(batchSequence, (uint16_t)dacIndex, buffers[dacIndex]);
+	}
+	++batchSequence;
+
+	int messageCount = 0;
+	for (int packetIndex = 0; packetIndex < encoder->getPacketCount(); ++packetIndex)
+	{
+		if (dropRate > 0.f && dropDistribution(dropGenerator) < dropRate)
+		{
+			metricsIncrement(MetricsCounter::UdpDroppedPackets);
+			continue;
+		}
+
+		auto &vector = vectors[messageCount];
+		vector.iov_base = (void *)encoder->getPacket(packetIndex);
+		vector.iov_len = encoder->getPacketSize(packetIndex);
+
+		auto &message = messages[messageCount];
+		message.msg_hdr = msghdr{};
+		message.msg_hdr.msg_iov = &vector;
+		message.msg_hdr.msg_iovlen = 1;
+
+		++messageCount;
+	}
+
+	// A whole batch is usually sent by a single system call.
+	int sentCount = 0;
+	while (sentCount < messageCount)
+	{
+		auto result = sendmmsg(socketDescriptor, messages.data() + sentCount, messageCount - sentCount, 0);
+		if (result < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			// The receiver not listening yet is not fatal.
+			if (errno == ECONNREFUSED)
+			{
+				break;
+			}
+
+			std::cerr << "Cannot send: " << std::strerror(errno) << "." << std::endl;
+			return false;
+		}
+		sentCount += result;
+	}
+
+	scheduleNextBatch(buffers[0].count);
+
+	return true;
+}
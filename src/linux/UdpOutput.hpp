@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cli.hpp>
+#include <memory>
+#include <random>
+#include <string>
+#include <sys/socket.h>
+#include <vector>
+
+#include "../common/Output.hpp"
+#include "../common/PointStreamCodec.hpp"
+
+// Sends batches over UDP, to be received by another instance with -input udp.
+class UdpOutput : public Output
+{
+public:
+	UdpOutput(const CommonParameters &commonParameters, cli::Parser &parser);
+	~UdpOutput();
+
+	InitializationStatus initialize() override;
+	void shutdown() override;
+
+	bool needPoints() override;
+	bool streamPoints(const PointBuffer *buffers) override;
+
+private:
+	std::string address;
+	uint16_t port;
+	int packetSize;
+	bool color16;
+	bool deltaPositions;
+	float dropRate;
+
+	std::unique_ptr<PointStreamCodec::Encoder> encoder;
+	std::vector<mmsghdr> messages;
+	std::vector<iovec> vectors;
+
+	std::minstd_rand dropGenerator;
+	std::uniform_real_distribution<float> dropDistribution;
+
+	int socketDescriptor{ -1 };
+	uint32_t batchSequence{ 0 };
+};
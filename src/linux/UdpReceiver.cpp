@@ -0,0 +1,264 @@
+#include "UdpReceiver.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <unistd.h>
+
+#include "../common/metrics.hpp"
+#include "../common/system.hpp"
+
+UdpReceiver::UdpReceiver(const CommonParameters &commonParameters, std::vector<PointPipeline> &pipelines, Output &output)
+	: commonParameters{ commonParameters }
+	, pipelines{ pipelines }
+	, output{ output }
+{
+	auto bufferCapacity = PointPipeline::getMaxCapacity(pipelines, commonParameters.pointCount);
+	for (int dacIndex = 0; dacIndex < commonParameters.dacCount; ++dacIndex)
+	{
+		buffers.emplace_back(bufferCapacity, *commonParameters.arena);
+	}
+	receivedPoints.resize(commonParameters.pointCount * commonParameters.dacCount);
+	expectedPacketCounts.resize(commonParameters.dacCount);
+
+	packetData.resize((std::size_t)MessageCount * MaxPacketSize);
+	messages.resize(MessageCount);
+	vectors.resize(MessageCount);
+
+	for (int index = 0; index < MessageCount; ++index)
+	{
+		vectors[index].iov_base = &packetData[(std::size_t)index * MaxPacketSize];
+		vectors[index].iov_len = MaxPacketSize;
+	}
+}
+
+UdpReceiver::~UdpReceiver()
+{
+	if (socketDescriptor >= 0)
+	{
+		close(socketDescriptor);
+	}
+}
+
+bool UdpReceiver::open(uint16_t port)
+{
+	socketDescriptor = socket(AF_INET, SOCK_DGRAM, 0);
+	if (socketDescriptor < 0)
+	{
+		std::cerr << "Cannot create socket: " << std::strerror(errno) << "." << std::endl;
+		return false;
+	}
+
+	// Bursts of a whole batch arrive at once.
+	int bufferSize = 4 << 20;
+	setsockopt(socketDescriptor, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+
+	if (bind(socketDescriptor, (sockaddr *)&address, sizeof(address)) < 0)
+	{
+		std::cerr << "Cannot bind socket: " << std::strerror(errno) << "." << std::endl;
+		return false;
+	}
+
+	if (commonParameters.verbose)
+	{
+		std::cout << "Listening on port " << port << "." << std::endl;
+	}
+
+	return true;
+}
+
+void UdpReceiver::run()
+{
+	for (;;)
+	{
+		for (int index = 0; index < MessageCount; ++index)
+		{
+			auto &message = messages[index];
+			message.msg_hdr = msghdr{};
+			message.msg_hdr.msg_iov = &vectors[index];
+			message.msg_hdr.msg_iovlen = 1;
+		}
+
+		// Blocks until at least one packet is available.
+		auto result = recvmmsg(socketDescriptor, messages.data(), MessageCount, MSG_WAITFORONE, nullptr);
+		if (result < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			std::cerr << "Cannot receive: " << std::strerror(errno) << "." << std::endl;
+			return;
+		}
+
+		for (int index = 0; index < result; ++index)
+		{
+			auto packet = (const uint8_t *)vectors[index].iov_base;
+			if (!handlePacket(packet, (int)messages[index].msg_len))
+			{
+				return;
+			}
+		}
+	}
+}
+
+bool UdpReceiver::handlePacket(const uint8_t *packet, int size)
+{
+	PointStreamCodec::PacketHeader header;
+	if (!PointStreamCodec::decodeHeader(packet, size, header))
+	{
+		return true;
+	}
+
+	if (header.dacIndex >= commonParameters.dacCount || header.batchPointCount > commonParameters.pointCount)
+	{
+		if (commonParameters.verbose)
+		{
+			std::cerr << "Received a batch which exceeds the point or DAC counts." << std::endl;
+		}
+		return true;
+	}
+
+	if (!hasSequence)
+	{
+		startBatch(header.batchSequence);
+	}
+	else if (!hasBatch || header.batchSequence != batchSequence)
+	{
+		auto distance = (int32_t)(header.batchSequence - batchSequence);
+
+		// Late or duplicate packet of a batch which has already been flushed.
+		if (distance <= 0 && distance >= -MaxReorderDistance)
+		{
+			return true;
+		}
+
+		// The current batch will never be completed.
+		if (hasBatch && !flushBatch())
+		{
+			return false;
+		}
+
+		if (distance > 0)
+		{
+			lostBatchCount += distance - 1;
+			metricsIncrement(MetricsCounter::UdpLostBatches, distance - 1);
+		}
+		else if (commonParameters.verbose)
+		{
+			// Further back than reordering goes, e.g. numbering started over: the new stream is followed.
+			std::cout << "Sender restarted." << std::endl;
+		}
+
+		startBatch(header.batchSequence);
+	}
+
+	auto &buffer = buffers[header.dacIndex];
+	if (!PointStreamCodec::decodePoints(packet, size, header, buffer))
+	{
+		return true;
+	}
+
+	buffer.count = header.batchPointCount;
+
+	std::memset(&receivedPoints[header.dacIndex * commonParameters.pointCount + header.firstPoint], 1, header.pointCount);
+	expectedPacketCounts[header.dacIndex] = header.packetCount;
+	++receivedPacketCount;
+
+	if (isBatchComplete())
+	{
+		if (!flushBatch())
+		{
+			return false;
+		}
+		hasBatch = false;
+	}
+
+	return true;
+}
+
+void UdpReceiver::startBatch(uint32_t sequence)
+{
+	hasSequence = true;
+	hasBatch = true;
+	batchSequence = sequence;
+	receivedPacketCount = 0;
+	std::fill(receivedPoints.begin(), receivedPoints.end(), 0);
+	std::fill(expectedPacketCounts.begin(), expectedPacketCounts.end(), 0);
+
+	// DACs without any received packet are left empty.
+	for (auto &buffer : buffers)
+	{
+		buffer.count = 0;
+	}
+}
+
+bool UdpReceiver::isBatchComplete() const
+{
+	int expectedPacketCount = 0;
+	for (auto count : expectedPacketCounts)
+	{
+		if (count == 0)
+		{
+			return false;
+		}
+		expectedPacketCount += count;
+	}
+	return receivedPacketCount == expectedPacketCount;
+}
+
+bool UdpReceiver::flushBatch()
+{
+	int expectedPacketCount = 0;
+	for (auto count : expectedPacketCounts)
+	{
+		expectedPacketCount += count;
+	}
+	if (receivedPacketCount < expectedPacketCount)
+	{
+		lostPacketCount += expectedPacketCount - receivedPacketCount;
+		metricsIncrement(MetricsCounter::UdpLostPackets, expectedPacketCount - receivedPacketCount);
+	}
+
+	for (int dacIndex = 0; dacIndex < commonParameters.dacCount; ++dacIndex)
+	{
+		auto &buffer = buffers[dacIndex];
+		auto dacReceivedPoints = &receivedPoints[dacIndex * commonParameters.pointCount];
+
+		for (int index = 0; index < buffer.count; ++index)
+		{
+			if (!dacReceivedPoints[index])
+			{
+				if (index > 0)
+				{
+					buffer.x[index] = buffer.x[index - 1];
+					buffer.y[index] = buffer.y[index - 1];
+				}
+				buffer.r[index] = buffer.g[index] = buffer.b[index] = 0.f;
+			}
+		}
+
+		pipelines[dacIndex].process(buffer);
+	}
+	PointPipeline::equalizeCounts(buffers);
+
+	if (commonParameters.verbose && (lostBatchCount > 0 || lostPacketCount > 0) && batchSequence % 100 == 0)
+	{
+		std::cout << "Lost " << lostBatchCount << " batches and " << lostPacketCount << " packets so far." << std::endl;
+	}
+
+	while (!output.needPoints())
+	{
+		systemPause();
+	}
+
+	return output.streamPoints(buffers.data());
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <sys/socket.h>
+#include <vector>
+
+#include "../common/Output.hpp"
+#include "../common/PointPipeline.hpp"
+#include "../common/PointStreamCodec.hpp"
+
+// Receives batches sent by UdpOutput, and feeds them to a local output through the local pipelines.
+//
+// Points of lost packets are blanked, holding the position of the previous received point. Batches may not hold
+// more than pointCount points per DAC.
+//
+// Late packets of batches already flushed are dropped. When the numbering goes further back, e.g. the sender has
+// restarted, the receiver follows the new stream.
+class UdpReceiver
+{
+public:
+	UdpReceiver(const CommonParameters &commonParameters, std::vector<PointPipeline> &pipelines, Output &output);
+	~UdpReceiver();
+
+	bool open(uint16_t port);
+
+	// Returns when the output fails.
+	void run();
+
+private:
+	static const int MessageCount = 64;
+	static const int MaxPacketSize = 65536;
+
+	// Packets of batches up to this many before the current one are considered late, and dropped. Further back,
+	// the sender is considered restarted.
+	static const int MaxReorderDistance = 4;
+
+	const CommonParameters &commonParameters;
+	std::vector<PointPipeline> &pipelines;
+	Output &output;
+
+	int socketDescriptor{ -1 };
+
+	std::vector<uint8_t> packetData;
+	std::vector<mmsghdr> messages;
+	std::vector<iovec> vectors;
+
+	std::vector<PointBuffer> buffers;
+	std::vector<uint8_t> receivedPoints;
+	std::vector<int> expectedPacketCounts; // Per DAC, 0 if unknown.
+	int receivedPacketCount{ 0 };
+
+	bool hasSequence{ false }; // Whether a batch has been started.
+	bool hasBatch{ false }; // Whether the current batch is being received, i.e. has not been flushed.
+	uint32_t batchSequence{ 0 };
+
+	uint64_t lostBatchCount{ 0 };
+	uint64_t lostPacketCount{ 0 };
+
+	bool handlePacket(const uint8_t *packet, int size);
+	void startBatch(uint32_t sequence);
+	bool isBatchComplete() const;
+	bool flushBatch();
+};
@@ -0,0 +1,71 @@
+#include "UniformSocket.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "socket.hpp"
+
+UniformSocket::~UniformSocket()
+{
+	if (socketDescriptor >= 0)
+	{
+		close(socketDescriptor);
+		socketRemove(path);
+	}
+}
+
+bool UniformSocket::open(const std::string &path)
+{
+	sockaddr_un address{};
+	if (path.size() >= sizeof(address.sun_path))
+	{
+		std::cerr << "Uniform socket path is too long." << std::endl;
+		return false;
+	}
+
+	socketDescriptor = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+	if (socketDescriptor < 0)
+	{
+		std::cerr << "Cannot create uniform socket: " << std::strerror(errno) << "." << std::endl;
+		return false;
+	}
+
+	address.sun_family = AF_UNIX;
+	std::strcpy(address.sun_path, path.c_str());
+
+	if (!socketRemove(path))
+	{
+		std::cerr << "Uniform socket path is taken by a file which is not a socket." << std::endl;
+		close(socketDescriptor);
+		socketDescriptor = -1;
+		return false;
+	}
+
+	if (bind(socketDescriptor, (sockaddr *)&address, sizeof(address)) < 0)
+	{
+		std::cerr << "Cannot bind uniform socket: " << std::strerror(errno) << "." << std::endl;
+		close(socketDescriptor);
+		socketDescriptor = -1;
+		return false;
+	}
+
+	this->path = path;
+	buffer.resize(MaxMessageSize);
+	return true;
+}
+
+bool UniformSocket::receive(std::string &message)
+{
+	auto size = recv(socketDescriptor, buffer.data(), buffer.size(), 0);
+	if (size < 0)
+	{
+		return false;
+	}
+
+	message.assign(buffer.data(), (std::size_t)size);
+	return true;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Local datagram socket receiving uniform definitions, e.g. from a control surface bridge. Each datagram holds
+// definitions in the UniformBlock syntax, e.g. "speed 1.5; tint 1 0 0".
+class UniformSocket
+{
+public:
+	~UniformSocket();
+
+	// Creates the socket file, replacing a stale one.
+	bool open(const std::string &path);
+
+	// Returns false if no datagram is pending, without blocking.
+	bool receive(std::string &message);
+
+private:
+	static const int MaxMessageSize = 65536;
+
+	std::string path;
+	int socketDescriptor{ -1 };
+	std::vector<char> buffer;
+};
@@ -0,0 +1,21 @@
+#include "socket.hpp"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool socketRemove(const std::string &path)
+{
+	struct stat status;
+	if (lstat(path.c_str(), &status) < 0)
+	{
+		return true;
+	}
+
+	if (!S_ISSOCK(status.st_mode))
+	{
+		return false;
+	}
+
+	unlink(path.c_str());
+	return true;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <string>
+
+// Removes the Unix socket at path, e.g. left by a previous run, but no other kind of file. Returns false if there
+// is one.
+bool socketRemove(const std::string &path);
@@ -0,0 +1,149 @@
+#include "../common/system.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <ctime>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+// Sleeps wake up within this duration after their deadline, on a non-loaded system.
+static const int64_t SpinDuration = 200000;
+
+static int64_t startingTime;
+
+static int64_t getMonotonicTime()
+{
+	timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (int64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+void systemStartTime()
+{
+	startingTime = getMonotonicTime();
+}
+
+double systemGetTime()
+{
+	return systemGetTimeNanoseconds() * 1e-9;
+}
+
+int64_t systemGetTimeNanoseconds()
+{
+	return getMonotonicTime() - startingTime;
+}
+
+std::tuple<std::string, std::string> systemSplitDirectoryNameAndBaseName(const std::string &path)
+{
+	char fullPathBuffer[PATH_MAX];
+	if (!realpath(path.c_str(), fullPathBuffer))
+	{
+		return std::make_tuple(std::string{}, std::string{});
+	}
+
+	std::string fullPath{ fullPathBuffer };
+
+	auto lastSlash = fullPath.rfind('/');
+	if (lastSlash == std::string::npos)
+	{
+		return std::make_tuple(std::string{}, std::string{});
+	}
+
+	return std::make_tuple(fullPath.substr(0, lastSlash + 1), fullPath.substr(lastSlash + 1));
+}
+
+void systemPause(float duration)
+{
+	if (duration <= 0.f)
+	{
+		sched_yield();
+		return;
+	}
+
+	auto nanoseconds = (int64_t)(duration * 1e9);
+	timespec time;
+	time.tv_sec = (time_t)(nanoseconds / 1000000000);
+	time.tv_nsec = (long)(nanoseconds % 1000000000);
+	while (clock_nanosleep(CLOCK_MONOTONIC, 0, &time, &time) != 0)
+	{
+	}
+}
+
+void systemWaitUntil(int64_t deadline)
+{
+	auto sleepDeadline = startingTime + deadline - SpinDuration;
+	if (sleepDeadline > getMonotonicTime())
+	{
+		timespec time;
+		time.tv_sec = (time_t)(sleepDeadline / 1000000000);
+		time.tv_nsec = (long)(sleepDeadline % 1000000000);
+
+		// Absolute deadlines are not shifted by interruptions.
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &time, nullptr) != 0)
+		{
+		}
+	}
+
+	while (systemGetTimeNanoseconds() < deadline)
+	{
+	}
+}
+
+bool systemSetThreadAffinity(int cpu)
+{
+	if (cpu >= CPU_SETSIZE)
+	{
+		return false;
+	}
+
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+bool systemSetThreadRealTimePriority(int priority, bool roundRobin)
+{
+	auto policy = roundRobin ? SCHED_RR : SCHED_FIFO;
+
+	sched_param parameters{};
+	parameters.sched_priority = std::min(std::max(priority, sched_get_priority_min(policy)), sched_get_priority_max(policy));
+	return pthread_setschedparam(pthread_self(), policy, &parameters) == 0;
+}
+
+bool systemLockMemory()
+{
+	return mlockall(MCL_CURRENT | MCL_FUTURE) == 0;
+}
+
+void *systemAllocatePages(std::size_t size, bool &hugePages)
+{
+	if (hugePages)
+	{
+		// Requires pages reserved in /proc/sys/vm/nr_hugepages.
+		auto address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (address != MAP_FAILED)
+		{
+			return address;
+		}
+
+		hugePages = false;
+	}
+
+	auto address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (address == MAP_FAILED)
+	{
+		return nullptr;
+	}
+
+	// Otherwise transparent huge pages may still back it.
+	madvise(address, size, MADV_HUGEPAGE);
+	return address;
+}
+
+void systemFreePages(void *address, std::size_t size, bool)
+{
+	munmap(address, size);
+}
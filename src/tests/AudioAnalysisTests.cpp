@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+
+#include "../common/AudioAnalysis.hpp"
+#include "test.hpp"
+
+static const char *WavPath = "audio-analysis-test.wav";
+static const int SampleRate = 44100;
+
+namespace
+{
+	void writeLittleEndian(std::ofstream &file, uint32_t value, int size)
+	{
+		for (int index = 0; index < size; ++index)
+		{
+			file.put((char)((value >> (index * 8)) & 0xFF));
+		}
+	}
+
+	// Mono 16-bit sine.
+	void writeSine(float frequency, float duration)
+	{
+		auto sampleCount = (uint32_t)(duration * SampleRate);
+
+		std::ofstream file{ WavPath, std::ios::binary };
+		file.write("RIFF", 4);
+		writeLittleEndian(file, 36 + sampleCount * 2, 4);
+		file.write("WAVEfmt ", 8);
+		writeLittleEndian(file, 16, 4);
+		writeLittleEndian(file, 1, 2); // PCM.
+		writeLittleEndian(file, 1, 2);
+		writeLittleEndian(file, SampleRate, 4);
+		writeLittleEndian(file, SampleRate * 2, 4);
+		writeLittleEndian(file, 2, 2);
+		writeLittleEndian(file, 16, 2);
+		file.write("data", 4);
+		writeLittleEndian(file, sampleCount * 2, 4);
+		for (uint32_t index = 0; index < sampleCount; ++index)
+		{
+			auto sample = (int16_t)(std::sin(2. * M_PI * frequency * index / SampleRate) * 16000.);
+			writeLittleEndian(file, (uint16_t)sample, 2);
+		}
+	}
+}
+
+TEST(AudioAnalysisFinishesBeforeSampling)
+{
+	writeSine(1000.f, 20.f);
+
+	AudioAnalysis analysis;
+	CHECK(analysis.start(WavPath));
+	analysis.finish();
+	std::remove(WavPath);
+
+	// The end of the file would likely not be analyzed yet without waiting.
+	float bands[AudioAnalysis::BandCount];
+	float onset;
+	analysis.sample(19., bands, onset);
+
+	auto maxBand = 0.f;
+	for (auto band : bands)
+	{
+		maxBand = std::max(maxBand, band);
+	}
+	CHECK(maxBand > .5f);
+}
@@ -0,0 +1,166 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../common/BeamSimulationOutput.hpp"
+#include "../common/PointBuffer.hpp"
+#include "test.hpp"
+
+// Simulates the points of example.frag, computed on the CPU, and compares the last frame with a reference.
+
+static const int ImageSize = 32;
+static const int PointCount = 1000;
+static const int BatchCount = 6; // One frame per batch.
+static const char *FramePath = "beam-simulation-test-%d.ppm";
+
+// Last frame, one row per line, two hex digits per pixel, the image being gray.
+static const char *ReferenceFrame =
+	"0000000000000000000000000000000000000000000000000000000000000000"
+	"0000000000000000000000000000000000000000000000000000000000000000"
+	"0000000000000000000000000000000000000000000000000000000000000000"
+	"0000000000000000000000000000000000000000000000000000000000000000"
+	"0000000000000000000000000000000000000000000000000000000000000000"
+	"0000000000000000000000000000000000000000000000000000000000000000"
+	"0000000000000000000000000000000000000000000000000000000000000000"
+	"0000000000000000000000000000000000000000000000000000000000000000"
+	"000000000000000026120d100e0d0b100b050707090909170000000000000000"
+	"000000000000000016001c0b07030503050b0804080e000b0000000000000000"
+	"00000000000000000e130033181a070000081a1c380009090000000000000000"
+	"000000000000000000240f2e130915151b0d0a173d1015000000000000000000"
+	"0000000000000000001f12031307111d1514071702131c000000000000000000"
+	"00000000000000000c06160803131c1319191602050d0c0e0000000000000000"
+	"00000000000000000c070a091d2d67454869322205060d0e0000000000000000"
+	"0000000000000000100000111e2c2186941d2c1f080001180000000000000000"
+	"00000000000000000f01000f1e282178851a291d0c0003150000000000000000"
+	"0000000000000000080b0b0b152365393a5d2c22090a0b0d0000000000000000"
+	"000000000000000007081a0902141a0f1718120306130b0e0000000000000000"
+	"0000000000000000001b140217040e221c0f0816001822000000000000000000"
+	"000000000000000000210a2b0a0412111a1306123c121e000000000000000000"
+	"00000000000000001015001c181a040000071d20320010100000000000000000"
+	"000000000000000018001b0e06040904050c05070c1400130000000000000000"
+	"00000000000000002b140e110e0b0d110e090b0c0c0e0f230000000000000000"
+	"0000000000000000000000000000000000000000000000000000000000000000"
+	"0000000000000000000000000000000000000000000000000000000000000000"
+	"0000000000000000000000000000000000000000000000000000000000000000"
+	"0000000000000000000000000000000000000000000000000000000000000000"
+	"0000000000000000000000000000000000000000000000000000000000000000"
+	"0000000000000000000000000000000000000000000000000000000000000000"
+	"0000000000000000000000000000000000000000000000000000000000000000"
+	"0000000000000000000000000000000000000000000000000000000000000000";
+
+// Levels may differ by this much from the reference, e.g. with another math library.
+static const int Tolerance = 2;
+
+namespace
+{
+	// Same as example.frag.
+	Point getExamplePoint(float index)
+	{
+		auto angle = index * .05f;
+		auto radius = std::fabs(std::sin(angle * .4f)) * .5f;
+		return Point{ std::cos(angle * 1.1f) * radius, std::sin(angle) * radius, 1.f, 1.f, 1.f };
+	}
+
+	// Returns the gray levels of the last frame, or nothing if it cannot be read.
+	std::vector<int> simulate(int threadCount)
+	{
+		CommonParameters commonParameters{};
+		commonParameters.dacCount = 1;
+		commonParameters.pointCount = PointCount;
+		commonParameters.maxPointCount = PointCount;
+		commonParameters.pointsPerSecond = 30000;
+
+		auto imageSize = std::to_string(ImageSize);
+		auto threadCountValue = std::to_string(threadCount);
+		const char *arguments[] = {
+			"tests",
+			"-is", imageSize.c_str(),
+			"-fr", "30",
+			"-pe", ".05",
+			"-ex", ".01",
+			"-tc", threadCountValue.c_str(),
+			"-op", FramePath,
+		};
+		cli::Parser parser{ sizeof(arguments) / sizeof(arguments[0]), (char **)arguments };
+
+		BeamSimulationOutput output{ commonParameters, parser };
+		CHECK(!parser.hasErrors());
+		if (output.initialize() != InitializationStatus::Success)
+		{
+			CHECK(!"Cannot initialize the output");
+			return {};
+		}
+
+		PointBuffer buffer{ PointCount };
+		for (int batchIndex = 0; batchIndex < BatchCount; ++batchIndex)
+		{
+			buffer.count = PointCount;
+			for (int index = 0; index < PointCount; ++index)
+			{
+				buffer.set(index, getExamplePoint((float)(batchIndex * PointCount + index)));
+			}
+			CHECK(output.streamPoints(&buffer));
+		}
+
+		std::vector<int> levels;
+		for (int frameIndex = 0; frameIndex < BatchCount; ++frameIndex)
+		{
+			char path[256];
+			std::snprintf(path, sizeof(path), FramePath, frameIndex);
+
+			std::ifstream file{ path, std::ios::binary };
+			std::string magic;
+			int width, height, maxValue;
+			file >> magic >> width >> height >> maxValue;
+			file.get();
+
+			std::vector<char> pixels((std::size_t)width * height * 3);
+			file.read(pixels.data(), (std::streamsize)pixels.size());
+			auto valid = file && magic == "P6" && width == ImageSize && height == ImageSize;
+			file.close();
+			std::remove(path);
+
+			if (!valid)
+			{
+				CHECK(!"Cannot read the frame");
+				return {};
+			}
+
+			if (frameIndex + 1 == BatchCount)
+			{
+				for (std::size_t index = 0; index < pixels.size(); index += 3)
+				{
+					levels.push_back((uint8_t)pixels[index]);
+				}
+			}
+		}
+		return levels;
+	}
+}
+
+TEST(BeamSimulationOutputMatchesReference)
+{
+	auto levels = simulate(1);
+	CHECK(levels.size() == ImageSize * ImageSize);
+
+	auto differentCount = 0;
+	for (std::size_t index = 0; index < levels.size(); ++index)
+	{
+		auto reference = (int)std::strtol(std::string(ReferenceFrame + index * 2, 2).c_str(), nullptr, 16);
+		if (std::abs(levels[index] - reference) > Tolerance)
+		{
+			++differentCount;
+		}
+	}
+	CHECK(differentCount == 0);
+}
+
+TEST(BeamSimulationOutputDoesNotDependOnThreadCount)
+{
+	auto levels = simulate(1);
+	CHECK(!levels.empty());
+	CHECK(simulate(3) == levels);
+}
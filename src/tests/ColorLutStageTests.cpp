@@ -0,0 +1,74 @@
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+#include "../common/ColorLutStage.hpp"
+#include "test.hpp"
+
+// Calibrations are written to a temporary file, which the stage loads without watching it.
+
+static const char *LutPath = "color-lut-test.txt";
+
+namespace
+{
+	// Returns false if the file is invalid, otherwise maps the color.
+	bool map(const char *calibration, Point &point)
+	{
+		{
+			std::ofstream file{ LutPath };
+			file << calibration;
+		}
+
+		ColorLutStage stage{ LutPath, nullptr };
+		auto valid = stage.load();
+		std::remove(LutPath);
+		if (!valid)
+		{
+			return false;
+		}
+
+		PointBuffer buffer{ 1 };
+		buffer.count = 1;
+		buffer.set(0, point);
+		stage.processRange(buffer, 0, 1);
+		point = buffer.get(0);
+		return true;
+	}
+
+	// Swaps red and blue.
+	const char *SwappingCube =
+		"cube 2\n"
+		"# Blue 0.\n"
+		"0 0 0  0 0 1\n"
+		"0 1 0  0 1 1\n"
+		"\n"
+		"# Blue 1.\n"
+		"1 0 0  1 0 1 # Green 0.\n"
+		"1 1 0  1 1 1\n";
+}
+
+TEST(ColorLutAcceptsCommentsInCube)
+{
+	auto point = Point{ 0.f, 0.f, 1.f, .5f, 0.f };
+	CHECK(map(SwappingCube, point));
+	CHECK(std::abs(point.r) < 1e-6f && std::abs(point.g - .5f) < 1e-6f && std::abs(point.b - 1.f) < 1e-6f);
+}
+
+TEST(ColorLutRejectsIncompleteCube)
+{
+	auto point = Point{};
+	CHECK(!map("cube 2\n0 0 0 1 0 0\n", point));
+	CHECK(!map("cube 2\n0 0 0 1 0 0 0 1 0 1 1 0 0 0 1 1 0 1 0 1 1 1 1 1 0\n", point));
+	CHECK(!map("cube 2\n0 0 0 1 0 0 0 1 0 1 1 0 0 0 1 1 0 1 0 1 1 x\n", point));
+}
+
+TEST(ColorLutBlanksNaNColors)
+{
+	auto point = Point{ 0.f, 0.f, NAN, .5f, INFINITY };
+	CHECK(map("r 1 0\ng 0 1\nb 0 .5\n", point));
+	CHECK(point.r == 1.f && std::abs(point.g - .5f) < 1e-4f && std::abs(point.b - .5f) < 1e-4f);
+
+	point = Point{ 0.f, 0.f, NAN, NAN, NAN };
+	CHECK(map(SwappingCube, point));
+	CHECK(point.r == 0.f && point.g == 0.f && point.b == 0.f);
+}
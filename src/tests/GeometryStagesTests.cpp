@@ -0,0 +1,82 @@
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+#include "../common/GeometryStages.hpp"
+#include "test.hpp"
+
+static const char *GridPath = "warp-grid-test.txt";
+
+namespace
+{
+	// Enough points for the SIMD and the scalar paths.
+	PointBuffer makeBuffer(const std::vector<Point> &points)
+	{
+		PointBuffer buffer{ (int)points.size() };
+		buffer.count = (int)points.size();
+		for (int index = 0; index < buffer.count; ++index)
+		{
+			buffer.set(index, points[index]);
+		}
+		return buffer;
+	}
+}
+
+TEST(HomographyBlanksPointsBehindHorizon)
+{
+	// w = 1 + x, so the horizon is the line x = -1.
+	const float matrix[9] = {
+		1.f, 0.f, 0.f,
+		0.f, 1.f, 0.f,
+		1.f, 0.f, 1.f,
+	};
+	HomographyStage stage{ matrix };
+
+	std::vector<Point> points;
+	for (int index = 0; index < 5; ++index)
+	{
+		points.push_back(Point{ 0.f, .5f, 1.f, 1.f, 1.f });
+		points.push_back(Point{ -1.f, .5f, 1.f, 1.f, 1.f });
+		points.push_back(Point{ -2.f, .5f, 1.f, 1.f, 1.f });
+	}
+
+	auto buffer = makeBuffer(points);
+	stage.processRange(buffer, 0, buffer.count);
+
+	for (int index = 0; index < buffer.count; ++index)
+	{
+		auto visible = index % 3 == 0;
+		CHECK(std::isfinite(buffer.x[index]) && std::isfinite(buffer.y[index]));
+		CHECK((buffer.r[index] == 1.f) == visible);
+		CHECK((buffer.g[index] == 1.f) == visible);
+		CHECK((buffer.b[index] == 1.f) == visible);
+		if (visible)
+		{
+			CHECK(buffer.x[index] == 0.f && buffer.y[index] == .5f);
+		}
+	}
+}
+
+TEST(WarpGridPassesNonFinitePointsThrough)
+{
+	{
+		// Identity grid.
+		std::ofstream file{ GridPath };
+		file << "2 2 -1 -1 1 -1 -1 1 1 1" << std::endl;
+	}
+
+	WarpGridStage stage;
+	CHECK(stage.load(GridPath));
+	std::remove(GridPath);
+
+	auto buffer = makeBuffer({
+		Point{ NAN, 0.f, 1.f, 1.f, 1.f },
+		Point{ 0.f, -INFINITY, 1.f, 1.f, 1.f },
+		Point{ .5f, -.25f, 1.f, 1.f, 1.f },
+	});
+	stage.processRange(buffer, 0, buffer.count);
+
+	CHECK(std::isnan(buffer.x[0]) && buffer.y[0] == 0.f);
+	CHECK(buffer.x[1] == 0.f && buffer.y[1] == -INFINITY);
+	CHECK(std::abs(buffer.x[2] - .5f) < 1e-6f && std::abs(buffer.y[2] + .25f) < 1e-6f);
+}
@@ -0,0 +1,64 @@
+#if defined(SYSTEM_LINUX)
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../linux/MetricsServer.hpp"
+#include "test.hpp"
+
+static const char *SocketPath = "metrics-server-test.sock";
+
+namespace
+{
+	bool isSocket(const char *path)
+	{
+		struct stat status;
+		return lstat(path, &status) == 0 && S_ISSOCK(status.st_mode);
+	}
+}
+
+TEST(MetricsServerKeepsOtherFilesAtSocketPath)
+{
+	{
+		std::ofstream file{ SocketPath };
+		file << "user data" << std::endl;
+	}
+
+	{
+		MetricsServer server;
+		CHECK(!server.open(0, SocketPath));
+	}
+
+	std::ifstream file{ SocketPath };
+	std::string content;
+	std::getline(file, content);
+	CHECK(content == "user data");
+	std::remove(SocketPath);
+}
+
+TEST(MetricsServerReplacesStaleSocket)
+{
+	// A socket left behind, e.g. by a crashed run.
+	auto descriptor = socket(AF_UNIX, SOCK_STREAM, 0);
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	std::strcpy(address.sun_path, SocketPath);
+	CHECK(bind(descriptor, (sockaddr *)&address, sizeof(address)) == 0);
+	close(descriptor);
+	CHECK(isSocket(SocketPath));
+
+	{
+		MetricsServer server;
+		CHECK(server.open(0, SocketPath));
+		CHECK(isSocket(SocketPath));
+	}
+	CHECK(!isSocket(SocketPath));
+}
+
+#endif
@@ -0,0 +1,116 @@
+#include "../common/BatchArena.hpp"
+#include "../common/PointPipeline.hpp"
+#include "test.hpp"
+
+namespace
+{
+	bool parse(const char *description)
+	{
+		PointStageContext context;
+		context.pointsPerSecond = 30000;
+		context.dacIndex = 0;
+		context.fileWatcher = nullptr;
+
+		PointPipeline pipeline;
+		return pipeline.parse(description, context);
+	}
+}
+
+TEST(PointPipelineRejectsNegativePathArguments)
+{
+	CHECK(parse("path 2 .5"));
+	CHECK(parse("path 2 .5 0 0"));
+	CHECK(!parse("path 2 .5 -.5"));
+	CHECK(!parse("path 2 .5 1 -1e-4"));
+}
+
+TEST(PointPipelineValidatesArcLengthRatios)
+{
+	CHECK(parse("resample-arc .01"));
+	CHECK(parse("resample-arc .01 .25"));
+	CHECK(parse("resample-arc .01 4 0"));
+	CHECK(!parse("resample-arc .01 0"));
+	CHECK(!parse("resample-arc .01 4 -1"));
+	CHECK(!parse("resample-arc .01 2 3"));
+}
+
+TEST(PointPipelineResetStartsOver)
+{
+	auto fill = [](PointBuffer &buffer, float offset)
+	{
+		buffer.count = 32;
+		for (int index = 0; index < buffer.count; ++index)
+		{
+			buffer.set(index, Point{ offset + index * .02f, -offset, 1.f, 1.f, 1.f });
+		}
+	};
+
+	PointStageContext context;
+	context.pointsPerSecond = 30000;
+	context.dacIndex = 0;
+	context.fileWatcher = nullptr;
+
+	const char *description = "resample 2; path 1000 .1";
+	PointPipeline pipeline;
+	PointPipeline freshPipeline;
+	CHECK(pipeline.parse(description, context));
+	CHECK(freshPipeline.parse(description, context));
+
+	BatchArena arena{ false };
+	pipeline.allocate(32, arena);
+	freshPipeline.allocate(32, arena);
+
+	auto capacity = pipeline.getMaxCapacity(32);
+	PointBuffer buffer{ capacity };
+	PointBuffer freshBuffer{ capacity };
+
+	fill(buffer, .5f);
+	pipeline.process(buffer);
+
+	pipeline.reset();
+	fill(buffer, -.5f);
+	pipeline.process(buffer);
+
+	fill(freshBuffer, -.5f);
+	freshPipeline.process(freshBuffer);
+
+	CHECK(buffer.count == freshBuffer.count);
+	for (int index = 0; index < buffer.count && index < freshBuffer.count; ++index)
+	{
+		auto point = buffer.get(index);
+		auto freshPoint = freshBuffer.get(index);
+		CHECK(point.x == freshPoint.x && point.y == freshPoint.y && point.r == freshPoint.r);
+	}
+}
+
+TEST(PointPipelineEqualizesCountsWithBlankedPoints)
+{
+	std::vector<PointBuffer> buffers;
+	buffers.emplace_back(8);
+	buffers.emplace_back(8);
+	buffers.emplace_back(8);
+
+	buffers[0].count = 5;
+	buffers[1].count = 3;
+	buffers[1].set(2, Point{ .5f, -.5f, 1.f, 1.f, 1.f });
+	for (int index = 0; index < 5; ++index)
+	{
+		buffers[0].set(index, Point{ 0.f, 0.f, 1.f, 1.f, 1.f });
+	}
+
+	PointPipeline::equalizeCounts(buffers);
+
+	for (auto &buffer : buffers)
+	{
+		CHECK(buffer.count == 5);
+	}
+
+	for (int index = 3; index < 5; ++index)
+	{
+		auto point = buffers[1].get(index);
+		CHECK(point.x == .5f && point.y == -.5f && point.r == 0.f && point.g == 0.f && point.b == 0.f);
+
+		auto emptyPoint = buffers[2].get(index);
+		CHECK(emptyPoint.x == 0.f && emptyPoint.y == 0.f && emptyPoint.r == 0.f);
+	}
+}
@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "../common/PowerLimiterStage.hpp"
+#include "test.hpp"
+
+static const int PointsPerSecond = 30000;
+static const float Window = .05f;
+static const int WindowPointCount = 1500;
+
+namespace
+{
+	// A white beam moving right from the origin, where the stage starts, at the given speed in units/s.
+	PointBuffer makeLine(int count, float speed)
+	{
+		PointBuffer stream{ count };
+		stream.count = count;
+		for (int index = 0; index < count; ++index)
+		{
+			stream.set(index, Point{ index * speed / PointsPerSecond, 0.f, 1.f, 1.f, 1.f });
+		}
+		return stream;
+	}
+
+	// Maximum of the delivered power summed over windows, relative to full power during a window.
+	float getMaxWindowPower(const std::vector<Point> &points)
+	{
+		auto maxSum = 0.f;
+		auto sum = 0.f;
+		for (size_t index = 0; index < points.size(); ++index)
+		{
+			sum += points[index].r;
+			if (index >= WindowPointCount)
+			{
+				sum -= points[index - WindowPointCount].r;
+			}
+			maxSum = std::max(maxSum, sum);
+		}
+		return maxSum / WindowPointCount;
+	}
+
+	// A beam slowing down to a stop then speeding up, so that the limits apply to part of the stream.
+	PointBuffer makeStream(int count)
+	{
+		PointBuffer stream{ count };
+		stream.count = count;
+		auto x = 0.f;
+		for (int index = 0; index < count; ++index)
+		{
+			x += .002f * std::abs(std::cos(index * .003f));
+			stream.set(index, Point{ std::sin(x * 7.f), x - 1.f, 1.f, .5f + .5f * std::sin(index * .01f), .25f });
+		}
+		return stream;
+	}
+
+	// Processes the stream in batches of the given sizes, in turn.
+	std::vector<Point> process(const PointBuffer &stream, const std::vector<int> &batchSizes, float minSpeed = 2.f, float maxAveragePower = .5f)
+	{
+		PowerLimiterStage stage{ PointsPerSecond, Window, minSpeed, maxAveragePower };
+
+		std::vector<Point> points;
+		int begin = 0;
+		for (int batchIndex = 0; begin < stream.count; ++batchIndex)
+		{
+			auto count = std::min(batchSizes[batchIndex % batchSizes.size()], stream.count - begin);
+
+			PointBuffer input{ count };
+			input.count = count;
+			for (int index = 0; index < count; ++index)
+			{
+				input.set(index, stream.get(begin + index));
+			}
+
+			PointBuffer output{ count };
+			stage.process(input, output);
+			for (int index = 0; index < output.count; ++index)
+			{
+				points.push_back(output.get(index));
+			}
+
+			begin += count;
+		}
+		return points;
+	}
+}
+
+TEST(PowerLimiterStageDoesNotDependOnBatchSizes)
+{
+	auto stream = makeStream(6000);
+
+	auto points = process(stream, { 1000 });
+	auto splitPoints = process(stream, { 137, 1, 512, 64 });
+
+	CHECK(points.size() == (size_t)stream.count);
+	CHECK(splitPoints.size() == points.size());
+
+	auto limited = false;
+	for (size_t index = 0; index < points.size() && index < splitPoints.size(); ++index)
+	{
+		auto &point = points[index];
+		auto &splitPoint = splitPoints[index];
+		CHECK(point.x == splitPoint.x && point.y == splitPoint.y);
+		CHECK(point.r == splitPoint.r && point.g == splitPoint.g && point.b == splitPoint.b);
+		limited = limited || point.r < 1.f;
+	}
+
+	// Otherwise the comparison would not exercise the window.
+	CHECK(limited);
+}
+
+TEST(PowerLimiterStageCapsPowerOfSlowBeam)
+{
+	// A quarter of the minimum speed allows a quarter of full power.
+	auto slowPoints = process(makeLine(6000, .5f), { 1000 }, 2.f, 1.f);
+	auto slowPower = getMaxWindowPower(slowPoints);
+	CHECK(slowPower <= .25f + 1e-3f);
+	CHECK(slowPower > .2f);
+
+	// Above the minimum speed, the average power limit applies.
+	auto fastPoints = process(makeLine(6000, 4.f), { 1000 }, 2.f, .5f);
+	auto fastPower = getMaxWindowPower(fastPoints);
+	CHECK(fastPower <= .5f + 1e-3f);
+	CHECK(fastPower > .45f);
+
+	// A static beam is blanked.
+	auto staticPoints = process(makeLine(6000, 0.f), { 1000 }, 2.f, 1.f);
+	CHECK(getMaxWindowPower(staticPoints) == 0.f);
+}
+
+TEST(PowerLimiterStageBlanksNonFinitePoints)
+{
+	auto stream = makeLine(4000, .5f);
+	for (int index = 2000; index < 2100; ++index)
+	{
+		auto point = stream.get(index);
+		point.x = index % 2 ? NAN : INFINITY;
+		point.g = index % 3 ? point.g : NAN;
+		stream.set(index, point);
+	}
+
+	auto points = process(stream, { 1000 }, 2.f, 1.f);
+	for (int index = 2000; index < 2100; ++index)
+	{
+		auto &point = points[index];
+		CHECK(point.r == 0.f && point.g == 0.f && point.b == 0.f);
+	}
+
+	// The jump does not count as travel.
+	CHECK(getMaxWindowPower(points) <= .25f + 1e-3f);
+	for (auto &point : points)
+	{
+		CHECK(std::isfinite(point.r) && std::isfinite(point.g) && std::isfinite(point.b));
+	}
+}
@@ -0,0 +1,93 @@
+#include <cmath>
+
+#include "../common/BatchArena.hpp"
+#include "../common/ResamplingStages.hpp"
+#include "test.hpp"
+
+static const int InputCount = 100;
+static const float Spacing = .01f;
+
+namespace
+{
+	// Processes batches of points moving right by the given step, and returns the output counts.
+	std::vector<int> resample(float step, int batchCount, std::vector<Point> *lastPoints = nullptr)
+	{
+		BatchArena arena{ false };
+		ArcLengthResamplingStage stage{ Spacing, .5f, 4.f };
+		stage.allocate(InputCount, arena);
+
+		PointBuffer input{ InputCount };
+		PointBuffer output{ stage.getMaxOutputCount(InputCount) };
+
+		std::vector<int> counts;
+		for (int batchIndex = 0; batchIndex < batchCount; ++batchIndex)
+		{
+			input.count = InputCount;
+			for (int index = 0; index < InputCount; ++index)
+			{
+				input.set(index, Point{ (batchIndex * InputCount + index) * step, 0.f, 1.f, 1.f, 1.f });
+			}
+
+			stage.process(input, output);
+			counts.push_back(output.count);
+
+			if (lastPoints)
+			{
+				lastPoints->clear();
+				for (int index = 0; index < output.count; ++index)
+				{
+					lastPoints->push_back(output.get(index));
+				}
+			}
+		}
+		return counts;
+	}
+}
+
+TEST(ArcLengthResamplingKeepsStaticBeam)
+{
+	std::vector<Point> points;
+	for (auto count : resample(0.f, 3, &points))
+	{
+		CHECK(count == InputCount / 2);
+	}
+	for (auto &point : points)
+	{
+		CHECK(point.x == 0.f && point.r == 1.f);
+	}
+}
+
+TEST(ArcLengthResamplingRefinesShortPaths)
+{
+	// 0.1 spacing per batch would give 1 point.
+	std::vector<Point> points;
+	for (auto count : resample(Spacing / InputCount, 3, &points))
+	{
+		CHECK(count >= InputCount / 2);
+		CHECK(count <= InputCount / 2 + 1);
+	}
+
+	// Evenly spread along the path.
+	auto step = 2.f * Spacing / InputCount;
+	for (size_t index = 1; index < points.size(); ++index)
+	{
+		auto distance = points[index].x - points[index - 1].x;
+		CHECK(distance >= 0.f);
+		CHECK(distance <= step * 1.01f);
+	}
+}
+
+TEST(ArcLengthResamplingKeepsSpacingOfLongPaths)
+{
+	// Two points per input point, between the minimum and the maximum, give or take rounding.
+	for (auto count : resample(Spacing * 2.f, 3))
+	{
+		CHECK(std::abs(count - InputCount * 2) <= 2);
+	}
+
+	// Capped.
+	for (auto count : resample(Spacing * 10.f, 3))
+	{
+		CHECK(count == InputCount * 4);
+	}
+}
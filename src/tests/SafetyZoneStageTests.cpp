@@ -0,0 +1,75 @@
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+#include "../common/SafetyZoneStage.hpp"
+#include "test.hpp"
+
+// Zones are written to a temporary file, which the stage loads without watching it.
+
+static const char *ZonePath = "safety-zone-test.txt";
+static const int Resolution = 64;
+
+namespace
+{
+	// Returns whether the point is blanked by the zone, and sets valid to the result of loading it.
+	bool isBlanked(const char *zone, float x, float y, bool &valid)
+	{
+		{
+			std::ofstream file{ ZonePath };
+			file << zone << std::endl;
+		}
+
+		SafetyZoneStage stage{ ZonePath, Resolution, nullptr };
+		valid = stage.load();
+
+		PointBuffer buffer{ 1 };
+		buffer.count = 1;
+		buffer.set(0, Point{ x, y, 1.f, 1.f, 1.f });
+		stage.processRange(buffer, 0, 1);
+
+		std::remove(ZonePath);
+		return buffer.r[0] == 0.f;
+	}
+
+	bool isBlanked(const char *zone, float x, float y)
+	{
+		bool valid;
+		auto blanked = isBlanked(zone, x, y, valid);
+		CHECK(valid);
+		return blanked;
+	}
+}
+
+TEST(SafetyZoneKeepsShapeOfPolygonsBeyondField)
+{
+	// Clamping the vertices would give a quad whose top edge misses this point.
+	CHECK(isBlanked("-3 -.9 3 -.9 0 3", .9f, 0.f));
+	CHECK(!isBlanked("-3 -.9 3 -.9 0 3", 0.f, -.97f));
+	CHECK(isBlanked("-1e6 -1e6 1e6 -1e6 0 1e6", 0.f, 0.f));
+}
+
+TEST(SafetyZoneMasksPointsBeyondField)
+{
+	// The zone is entirely beyond the right border.
+	CHECK(isBlanked("2 -.5 3 -.5 3 .5 2 .5", 5.f, 0.f));
+	CHECK(!isBlanked("2 -.5 3 -.5 3 .5 2 .5", .5f, 0.f));
+	CHECK(isBlanked("2 2 3 2 3 3", 4.f, 4.f));
+}
+
+TEST(SafetyZoneRejectsOddCoordinateCount)
+{
+	bool valid;
+	CHECK(isBlanked("0 0 .5 0 .5", 0.f, 0.f, valid));
+	CHECK(!valid);
+}
+
+TEST(SafetyZoneBlanksNonFinitePoints)
+{
+	// Outside of the zone, and without any zone.
+	CHECK(isBlanked("2 2 3 2 3 3", NAN, 0.f));
+	CHECK(isBlanked("2 2 3 2 3 3", 0.f, NAN));
+	CHECK(isBlanked("2 2 3 2 3 3", INFINITY, 0.f));
+	CHECK(isBlanked("", 0.f, -INFINITY));
+	CHECK(!isBlanked("", 0.f, 0.f));
+}
@@ -0,0 +1,67 @@
+#if defined(SYSTEM_LINUX)
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "../linux/SharedMemoryOutput.hpp"
+#include "test.hpp"
+
+static const char *Name = "/etherdream-glsl-test";
+
+TEST(SharedMemoryOutputKeepsMappingOfPreviousRun)
+{
+	// A reader of a previous run, whose layout differs.
+	const size_t previousSize = 4096;
+	auto fd = shm_open(Name, O_CREAT | O_RDWR, 0644);
+	CHECK(fd >= 0);
+	CHECK(ftruncate(fd, previousSize) == 0);
+	auto previous = (uint8_t *)mmap(nullptr, previousSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	CHECK(previous != MAP_FAILED);
+	if (previous == MAP_FAILED)
+	{
+		return;
+	}
+	previous[previousSize - 1] = 42;
+
+	CommonParameters commonParameters{};
+	commonParameters.dacCount = 1;
+	commonParameters.pointCount = 64;
+	commonParameters.maxPointCount = 64;
+	commonParameters.pointsPerSecond = 30000;
+
+	const char *arguments[] = {
+		"tests",
+		"-n", Name,
+		"-c", "2",
+	};
+	cli::Parser parser{ sizeof(arguments) / sizeof(arguments[0]), (char **)arguments };
+
+	SharedMemoryOutput output{ commonParameters, parser };
+	CHECK(!parser.hasErrors());
+	CHECK(output.initialize() == InitializationStatus::Success);
+
+	// Reading would raise SIGBUS if the object had been truncated.
+	CHECK(previous[previousSize - 1] == 42);
+	munmap(previous, previousSize);
+
+	// The new object is initialized from scratch.
+	fd = shm_open(Name, O_RDONLY, 0);
+	CHECK(fd >= 0);
+	auto size = lseek(fd, 0, SEEK_END);
+	auto header = (const SharedMemoryRing::Header *)mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	CHECK(header != MAP_FAILED);
+	if (header != MAP_FAILED)
+	{
+		CHECK(header->magic == SharedMemoryRing::Magic);
+		CHECK(header->slotCount == 2);
+		CHECK(header->writeSequence.load() == 0);
+		munmap((void *)header, size);
+	}
+
+	output.shutdown();
+}
+
+#endif
@@ -0,0 +1,223 @@
+#if defined(SYSTEM_LINUX)
+
+#include <arpa/inet.h>
+#include <cmath>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+#include "../common/BatchArena.hpp"
+#include "../common/PointStreamCodec.hpp"
+#include "../linux/UdpReceiver.hpp"
+#include "test.hpp"
+
+// Sends packets over the loopback interface, in a chosen order, to a receiver running on its own thread.
+
+static const uint16_t Port = 47765;
+static const int PointCount = 64;
+static const int PacketSize = PointStreamCodec::HeaderSize + 16 * 7; // 16 points per packet.
+
+namespace
+{
+	struct ReceivedBatch
+	{
+		int sequence; // As encoded in the positions.
+		std::vector<Point> points;
+	};
+
+	// Collects batches, until the one-point batch which ends the test.
+	class CollectingOutput : public Output
+	{
+	public:
+		std::vector<ReceivedBatch> batches;
+
+		CollectingOutput(const CommonParameters &commonParameters)
+			: Output{ commonParameters }
+		{
+		}
+
+		InitializationStatus initialize() override
+		{
+			return InitializationStatus::Success;
+		}
+
+		bool needPoints() override
+		{
+			return true;
+		}
+
+		bool streamPoints(const PointBuffer *buffers) override
+		{
+			auto &buffer = buffers[0];
+			if (buffer.count == 1)
+			{
+				return false;
+			}
+
+			ReceivedBatch batch;
+			batch.sequence = (int)std::lround(buffer.x[0] * 256.f);
+			for (int index = 0; index < buffer.count; ++index)
+			{
+				batch.points.push_back(buffer.get(index));
+			}
+			batches.push_back(batch);
+			return true;
+		}
+	};
+
+	typedef std::vector<std::vector<uint8_t>> Packets;
+
+	// The sequence is encoded in the X coordinates, modulo 256.
+	Packets encodeBatch(uint32_t sequence, int pointCount = PointCount)
+	{
+		PointBuffer buffer{ pointCount };
+		buffer.count = pointCount;
+		for (int index = 0; index < pointCount; ++index)
+		{
+			buffer.set(index, Point{ (sequence % 256) / 256.f, (float)index / pointCount, 1.f, 1.f, 1.f });
+		}
+
+		PointStreamCodec::Encoder encoder{ PacketSize, false, false };
+		encoder.encode(sequence, 0, buffer);
+
+		Packets packets;
+		for (int index = 0; index < encoder.getPacketCount(); ++index)
+		{
+			auto packet = encoder.getPacket(index);
+			packets.emplace_back(packet, packet + encoder.getPacketSize(index));
+		}
+		return packets;
+	}
+
+	// Sends the packets then a one-point batch far ahead, which is always accepted, and returns the batches
+	// received before it.
+	std::vector<ReceivedBatch> receive(const Packets &packets)
+	{
+		CommonParameters commonParameters{};
+		commonParameters.dacCount = 1;
+		commonParameters.pointCount = PointCount;
+		commonParameters.maxPointCount = PointCount;
+		commonParameters.pointsPerSecond = 30000;
+
+		BatchArena arena{ false };
+		commonParameters.arena = &arena;
+
+		std::vector<PointPipeline> pipelines(1);
+		pipelines[0].allocate(PointCount, arena);
+
+		CollectingOutput output{ commonParameters };
+		UdpReceiver receiver{ commonParameters, pipelines, output };
+		if (!receiver.open(Port))
+		{
+			CHECK(!"Cannot open the receiver");
+			return {};
+		}
+
+		std::thread thread{ &UdpReceiver::run, &receiver };
+
+		auto socketDescriptor = socket(AF_INET, SOCK_DGRAM, 0);
+		sockaddr_in address{};
+		address.sin_family = AF_INET;
+		address.sin_port = htons(Port);
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		auto allPackets = packets;
+		auto endPackets = encodeBatch(1000000, 1);
+		allPackets.insert(allPackets.end(), endPackets.begin(), endPackets.end());
+		for (auto &packet : allPackets)
+		{
+			sendto(socketDescriptor, packet.data(), packet.size(), 0, (sockaddr *)&address, sizeof(address));
+		}
+		close(socketDescriptor);
+
+		thread.join();
+		return output.batches;
+	}
+
+	bool isBlanked(const Point &point)
+	{
+		return point.r == 0.f && point.g == 0.f && point.b == 0.f;
+	}
+}
+
+TEST(UdpReceiverBlanksLostPackets)
+{
+	Packets packets;
+	for (uint32_t sequence = 0; sequence < 3; ++sequence)
+	{
+		auto batchPackets = encodeBatch(sequence);
+		CHECK(batchPackets.size() == 4);
+		if (sequence == 1)
+		{
+			batchPackets.erase(batchPackets.begin() + 1);
+		}
+		packets.insert(packets.end(), batchPackets.begin(), batchPackets.end());
+	}
+
+	auto batches = receive(packets);
+	CHECK(batches.size() == 3);
+	for (int index = 0; index < (int)batches.size(); ++index)
+	{
+		auto &batch = batches[index];
+		CHECK(batch.sequence == index);
+		CHECK(batch.points.size() == PointCount);
+		for (int pointIndex = 0; pointIndex < (int)batch.points.size(); ++pointIndex)
+		{
+			auto lost = index == 1 && pointIndex >= 16 && pointIndex < 32;
+			CHECK(isBlanked(batch.points[pointIndex]) == lost);
+		}
+	}
+}
+
+TEST(UdpReceiverReordersPacketsAndDropsLateOnes)
+{
+	auto batch0 = encodeBatch(0);
+	auto batch1 = encodeBatch(1);
+	auto batch2 = encodeBatch(2);
+
+	Packets packets{ batch0[3], batch0[1], batch0[0], batch0[2] };
+	packets.insert(packets.end(), batch1.begin(), batch1.end());
+
+	// A duplicate of a flushed batch, which must not start it again.
+	packets.push_back(batch0[2]);
+	packets.insert(packets.end(), batch2.begin(), batch2.end());
+
+	auto batches = receive(packets);
+	CHECK(batches.size() == 3);
+	for (int index = 0; index < (int)batches.size(); ++index)
+	{
+		CHECK(batches[index].sequence == index);
+		for (auto &point : batches[index].points)
+		{
+			CHECK(!isBlanked(point));
+		}
+	}
+}
+
+TEST(UdpReceiverFollowsRestartedSender)
+{
+	const uint32_t sequences[] = { 100, 101, 0, 1 };
+
+	Packets packets;
+	for (auto sequence : sequences)
+	{
+		auto batchPackets = encodeBatch(sequence);
+
+		// The sender stops in the middle of a batch, which is still being received when it restarts.
+		if (sequence == 101)
+		{
+			batchPackets.pop_back();
+		}
+		packets.insert(packets.end(), batchPackets.begin(), batchPackets.end());
+	}
+
+	auto batches = receive(packets);
+	CHECK(batches.size() == 4);
+	for (int index = 0; index < (int)batches.size() && index < 4; ++index)
+	{
+		CHECK(batches[index].sequence == (int)sequences[index]);
+	}
+}
+
+#endif
@@ -0,0 +1,45 @@
+#include <cstring>
+#include <iostream>
+
+#include "test.hpp"
+
+// Runs the test cases whose names contain the first argument, or all of them. Returns the number of failed cases.
+
+static int failureCount;
+
+std::vector<test::Case> &test::getCases()
+{
+	static std::vector<Case> cases;
+	return cases;
+}
+
+void test::fail(const char *file, int line, const char *condition)
+{
+	std::cerr << file << ":" << line << ": check failed: " << condition << std::endl;
+	++failureCount;
+}
+
+int main(int argc, char **argv)
+{
+	auto filter = argc > 1 ? argv[1] : "";
+
+	int failedCaseCount = 0;
+	for (auto &testCase : test::getCases())
+	{
+		if (!std::strstr(testCase.name, filter))
+		{
+			continue;
+		}
+
+		failureCount = 0;
+		testCase.function();
+
+		std::cout << (failureCount == 0 ? "PASS " : "FAIL ") << testCase.name << std::endl;
+		if (failureCount > 0)
+		{
+			++failedCaseCount;
+		}
+	}
+
+	return failedCaseCount;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+
+// Minimal test registry, to avoid a dependency: TEST(name) defines a test case, CHECK(condition) reports a failure
+// and lets the case continue.
+namespace test
+{
+	struct Case
+	{
+		const char *name;
+		void (*function)();
+	};
+
+	std::vector<Case> &getCases();
+
+	void fail(const char *file, int line, const char *condition);
+
+	struct Registration
+	{
+		Registration(const char *name, void (*function)())
+		{
+			getCases().push_back({ name, function });
+		}
+	};
+}
+
+#define TEST(name) \
+	static void name(); \
+	static test::Registration name##Registration{ #name, name }; \
+	static void name()
+
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			test::fail(__FILE__, __LINE__, #condition); \
+		} \
+	} while (false)
@@ -1,45 +1,53 @@
 #include "EtherDreamOutput.hpp"
 
+#include "../common/BatchArena.hpp"
+#include "../common/PointBuffer.hpp"
+
+#include <cstdlib>
+#include <sstream>
+
 const int EtherDreamOutput::NameBufferSize = 256;
 
+static std::vector<std::string> splitList(const char *list)
+{
+	std::vector<std::string> items;
+	if (list == nullptr)
+	{
+		return items;
+	}
+
+	std::istringstream stream{ list };
+	std::string item;
+	while (std::getline(stream, item, ','))
+	{
+		items.push_back(item);
+	}
+	return items;
+}
+
 EtherDreamOutput::EtherDreamOutput(const CommonParameters &commonParameters, cli::Parser &parser)
 	: Output{ commonParameters }
 {
-	points.reset(new EAD_Pnt_s[commonParameters.pointCount]);
-
-	cardIndex = parser.option("card-index")
+	auto cardIndexList = parser.option("card-index")
 		.alias("i")
-		.description("Card index in the device list.")
-		.defaultValue(0)
-		.getValueAs<int>();
+		.description("Card indices in the device list, comma-separated, one per DAC.")
+		.defaultValue("0")
+		.getValue();
+
+	for (auto &item : splitList(cardIndexList))
+	{
+		cardIndices.push_back(std::atoi(item.c_str()));
+	}
 
-	cardName = parser.option("card-name")
+	cardNames = splitList(parser.option("card-name")
 		.alias("n")
-		.description("Card name in the device list (overrides card-index).")
-		.getValue();
+		.description("Card names in the device list, comma-separated, one per DAC (overrides card-index).")
+		.getValue());
 
 	listDevices = parser.flag("list-devices")
 		.alias("l")
 		.description("Lists devices.")
 		.getValue();
-
-	offsetX = parser.option("offset-x")
-		.alias("ox")
-		.description("Offsets X coordinates.")
-		.defaultValue("0")
-		.getValueAs<float>();
-
-	offsetY = parser.option("offset-y")
-		.alias("oy")
-		.description("Offsets Y coordinates.")
-		.defaultValue("0")
-		.getValueAs<float>();
-
-	scale = parser.option("scale")
-		.alias("sc")
-		.description("Scales coordinates.")
-		.defaultValue("1")
-		.getValueAs<float>();
 }
 
 EtherDreamOutput::~EtherDreamOutput()
@@ -64,40 +72,71 @@ InitializationStatus EtherDreamOutput::initialize()
 		return InitializationStatus::RequestExit;
 	}
 
-	if (cardName != nullptr)
+	if (!cardNames.empty())
 	{
-		cardIndex = -1;
+		cardIndices.clear();
 
-		for (int index = 0; index < cardCount; ++index)
+		for (auto &cardName : cardNames)
 		{
-			char nameBuffer[NameBufferSize];
-			EtherDreamGetDeviceName(&index, nameBuffer, sizeof(nameBuffer));
-			if (!std::strncmp(cardName, nameBuffer, NameBufferSize))
+			int cardIndex = -1;
+
+			for (int index = 0; index < cardCount; ++index)
 			{
-				cardIndex = index;
-				break;
+				char nameBuffer[NameBufferSize];
+				EtherDreamGetDeviceName(&index, nameBuffer, sizeof(nameBuffer));
+				if (!std::strncmp(cardName.c_str(), nameBuffer, NameBufferSize))
+				{
+					cardIndex = index;
+					break;
+				}
 			}
-		}
 
-		if (cardIndex < 0)
-		{
-			std::cerr << "Card name was not found." << std::endl;
-			return InitializationStatus::Failure;
+			if (cardIndex < 0)
+			{
+				std::cerr << "Card name " << cardName << " was not found." << std::endl;
+				return InitializationStatus::Failure;
+			}
+
+			cardIndices.push_back(cardIndex);
 		}
 	}
-	else if (cardIndex < 0 || cardIndex >= cardCount)
+
+	if ((int)cardIndices.size() != commonParameters.dacCount)
 	{
-		std::cerr << "Card index is out of bounds." << std::endl;
+		std::cerr << "Expected " << commonParameters.dacCount << " cards, got " << cardIndices.size() << "." << std::endl;
 		return InitializationStatus::Failure;
 	}
 
-	auto result = EtherDreamOpenDevice(&cardIndex);
-	if (!result)
+	for (auto cardIndex : cardIndices)
 	{
-		std::cerr << "Cannot connect." << std::endl;
-		return InitializationStatus::Failure;
+		if (cardIndex < 0 || cardIndex >= cardCount)
+		{
+			std::cerr << "Card index " << cardIndex << " is out of bounds." << std::endl;
+			return InitializationStatus::Failure;
+		}
+	}
+
+	for (auto &cardIndex : cardIndices)
+	{
+		auto result = EtherDreamOpenDevice(&cardIndex);
+		if (!result)
+		{
+			std::cerr << "Cannot connect to card " << cardIndex << "." << std::endl;
+
+			for (int index = 0; index < openCardCount; ++index)
+			{
+				EtherDreamCloseDevice(&cardIndices[index]);
+			}
+			openCardCount = 0;
+
+			return InitializationStatus::Failure;
+		}
+
+		++openCardCount;
 	}
 
+	points = commonParameters.arena->allocate<EAD_Pnt_s>((std::size_t)commonParameters.maxPointCount * commonParameters.dacCount);
+
 	std::cout << "Connected." << std::endl;
 	open = true;
 	return InitializationStatus::Success;
@@ -107,14 +146,32 @@ void EtherDreamOutput::shutdown()
 {
 	if (open)
 	{
-		EtherDreamCloseDevice(&cardIndex);
+		for (int index = 0; index < openCardCount; ++index)
+		{
+			EtherDreamCloseDevice(&cardIndices[index]);
+		}
+		openCardCount = 0;
 		open = false;
 	}
 }
 
 bool EtherDreamOutput::needPoints()
 {
-	return open && (EtherDreamGetStatus(&cardIndex) == GET_STATUS_READY);
+	if (!open)
+	{
+		return false;
+	}
+
+	// Frames are only written when every card can accept one, so that all DACs share the same clock and stay phase-aligned.
+	for (auto &cardIndex : cardIndices)
+	{
+		if (EtherDreamGetStatus(&cardIndex) != GET_STATUS_READY)
+		{
+			return false;
+		}
+	}
+
+	return true;
 }
 
 static float clamp(float t, float min, float max)
@@ -132,19 +189,52 @@ static float clamp(float t, float min, float max)
 	return t;
 }
 
-bool EtherDreamOutput::streamPoints(const Point *data)
+bool EtherDreamOutput::streamPoints(const PointBuffer *buffers)
 {
-	for (int i = 0; i < commonParameters.pointCount; ++i)
+	return writeFrames(buffers, 1);
+}
+
+bool EtherDreamOutput::canRepeatPoints() const
+{
+	return true;
+}
+
+bool EtherDreamOutput::streamRepeatedPoints(const PointBuffer *buffers)
+{
+	// The DAC repeats the frame until the next one is written.
+	return writeFrames(buffers, (uint16_t)-1);
+}
+
+void EtherDreamOutput::convertPoints(const PointBuffer &buffer, EAD_Pnt_s *points)
+{
+	for (int i = 0; i < buffer.count; ++i)
 	{
-		auto &fromPoint = data[i];
 		auto &toPoint = points[i];
 
-		toPoint.X = (int16_t)clamp((fromPoint.x + offsetX) * scale * 32767.f, -32768.f, 32767.f);
-		toPoint.Y = (int16_t)clamp((fromPoint.y + offsetY) * scale * 32767.f, -32768.f, 32767.f);
-		toPoint.R = (uint16_t)clamp(fromPoint.r * 65535.f, 0.f, 65535.f);
-		toPoint.G = (uint16_t)clamp(fromPoint.g * 65535.f, 0.f, 65535.f);
-		toPoint.B = (uint16_t)clamp(fromPoint.b * 65535.f, 0.f, 65535.f);
+		toPoint.X = (int16_t)clamp(buffer.x[i] * 32767.f, -32768.f, 32767.f);
+		toPoint.Y = (int16_t)clamp(buffer.y[i] * 32767.f, -32768.f, 32767.f);
+		toPoint.R = (uint16_t)clamp(buffer.r[i] * 65535.f, 0.f, 65535.f);
+		toPoint.G = (uint16_t)clamp(buffer.g[i] * 65535.f, 0.f, 65535.f);
+		toPoint.B = (uint16_t)clamp(buffer.b[i] * 65535.f, 0.f, 65535.f);
+	}
+}
+
+bool EtherDreamOutput::writeFrames(const PointBuffer *buffers, uint16_t repetitionCount)
+{
+	for (int dacIndex = 0; dacIndex < commonParameters.dacCount; ++dacIndex)
+	{
+		convertPoints(buffers[dacIndex], points + dacIndex * commonParameters.maxPointCount);
+	}
+
+	// Conversion is done beforehand, so that frames are written back to back.
+	for (int dacIndex = 0; dacIndex < commonParameters.dacCount; ++dacIndex)
+	{
+		auto dacPoints = points + dacIndex * commonParameters.maxPointCount;
+		if (!EtherDreamWriteFrame(&cardIndices[dacIndex], dacPoints, sizeof(EAD_Pnt_s) * buffers[dacIndex].count, commonParameters.pointsPerSecond, repetitionCount))
+		{
+			return false;
+		}
 	}
 
-	return EtherDreamWriteFrame(&cardIndex, points.get(), sizeof(EAD_Pnt_s) * commonParameters.pointCount, commonParameters.pointsPerSecond, 1);
+	return true;
 }
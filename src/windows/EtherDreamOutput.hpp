@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <cli.hpp>
+#include <vector>
 #include <windows.h>
 #include <j4cDAC.h>
 
@@ -12,6 +13,9 @@ class EtherDreamOutput : public Output
 public:
 	static const int NameBufferSize;
 
+	// Converts to the DAC format, points must hold buffer.count points.
+	static void convertPoints(const PointBuffer &buffer, EAD_Pnt_s *points);
+
 	EtherDreamOutput(const CommonParameters &commonParameters, cli::Parser &parser);
 	~EtherDreamOutput();
 
@@ -19,17 +23,20 @@ public:
 	void shutdown() override;
 
 	bool needPoints() override;
-	bool streamPoints(const Point *data) override;
+	bool streamPoints(const PointBuffer *buffers) override;
+
+	bool canRepeatPoints() const override;
+	bool streamRepeatedPoints(const PointBuffer *buffers) override;
 
 private:
-	std::unique_ptr<EAD_Pnt_s[]> points;
+	EAD_Pnt_s *points{ nullptr }; // From the batch arena.
 
-	int cardIndex;
-	const char *cardName;
+	std::vector<int> cardIndices; // One per DAC.
+	std::vector<std::string> cardNames;
 	bool listDevices;
-	float offsetX;
-	float offsetY;
-	float scale;
 
+	int openCardCount{ 0 };
 	bool open{ false };
+
+	bool writeFrames(const PointBuffer *buffers, uint16_t repetitionCount);
 };
@@ -2,24 +2,36 @@
 
 #include <memory>
 #include <windows.h>
+#include <mmsystem.h>
+
+// Sleeps wake up within this duration after their deadline, once the timer resolution is raised.
+static const int64_t SpinDuration = 2000000;
 
 static LARGE_INTEGER startingTime;
-static float timeFactor;
+static LARGE_INTEGER frequency;
 
 void systemStartTime()
 {
-	LARGE_INTEGER frequency;
 	QueryPerformanceFrequency(&frequency);
-	timeFactor = 1.f / frequency.QuadPart;
-
 	QueryPerformanceCounter(&startingTime);
+
+	// Sleep granularity defaults to the scheduler tick, about 15 ms.
+	timeBeginPeriod(1);
+}
+
+double systemGetTime()
+{
+	return systemGetTimeNanoseconds() * 1e-9;
 }
 
-float systemGetTime()
+int64_t systemGetTimeNanoseconds()
 {
 	LARGE_INTEGER time;
 	QueryPerformanceCounter(&time);
-	return (time.QuadPart - startingTime.QuadPart) * timeFactor;
+
+	// Split to avoid overflowing after a few hours.
+	auto ticks = time.QuadPart - startingTime.QuadPart;
+	return ticks / frequency.QuadPart * 1000000000 + ticks % frequency.QuadPart * 1000000000 / frequency.QuadPart;
 }
 
 std::tuple<std::string, std::string> systemSplitDirectoryNameAndBaseName(const std::string &path)
@@ -49,3 +61,65 @@ void systemPause(float duration)
 {
 	Sleep((int)(duration * 1e3));
 }
+
+void systemWaitUntil(int64_t deadline)
+{
+	auto sleepDuration = deadline - SpinDuration - systemGetTimeNanoseconds();
+	if (sleepDuration > 0)
+	{
+		Sleep((DWORD)(sleepDuration / 1000000));
+	}
+
+	while (systemGetTimeNanoseconds() < deadline)
+	{
+		YieldProcessor();
+	}
+}
+
+bool systemSetThreadAffinity(int cpu)
+{
+	if (cpu >= (int)(sizeof(DWORD_PTR) * 8))
+	{
+		return false;
+	}
+
+	return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+}
+
+bool systemSetThreadRealTimePriority(int, bool)
+{
+	// Windows has no per-thread policy nor priority range, only the highest level of the process class.
+	return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) != 0;
+}
+
+bool systemLockMemory()
+{
+	// Only explicit ranges can be locked, with VirtualLock.
+	return false;
+}
+
+void *systemAllocatePages(std::size_t size, bool &hugePages)
+{
+	if (hugePages)
+	{
+		// Requires the "Lock pages in memory" privilege.
+		auto largePageSize = GetLargePageMinimum();
+		if (largePageSize > 0 && size % largePageSize == 0)
+		{
+			auto address = VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+			if (address)
+			{
+				return address;
+			}
+		}
+
+		hugePages = false;
+	}
+
+	return VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+}
+
+void systemFreePages(void *address, std::size_t, bool)
+{
+	VirtualFree(address, 0, MEM_RELEASE);
+}